@@ -0,0 +1,140 @@
+#include "../src/libnfporb.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+#include <new>
+
+using namespace libnfporb;
+using namespace std;
+
+//the number of heap allocations since counting was enabled
+static size_t allocations = 0;
+static bool counting = false;
+
+void* operator new(size_t size) {
+	if (counting)
+		++allocations;
+	void* p = std::malloc(size == 0 ? 1 : size);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	operator delete(p);
+}
+
+struct ReplayResult {
+	size_t steps_ = 0;
+	//the allocations of all steps but the feasibility filters that fell back to the boost predicates
+	size_t allocations_ = 0;
+	//the feasibility filters that fell back to the boost predicates, which allocate internally
+	size_t predicateSteps_ = 0;
+};
+
+/**
+ * @brief Replay the steps of the slide at every point of the outer ring of the NFP, which are positions where B touches A.
+ */
+ReplayResult replay(const polygon_t& pA, const SoaRing& rA, const EdgeIndex& indexA, const SoaRing& rB, const EdgeIndex& indexB, const nfp_t& nfp, NfpIndex& nfpIndex, std::vector<bool>& visitedA, NfpWorkspace& workspace) {
+	ReplayResult result;
+	point_t offset;
+	workspace.history_.clear();
+	workspace.contacts_.reset();
+	const polygon_t::ring_type& outer = nfp.front();
+	allocations = 0;
+	counting = true;
+	for (psize_t i = 0; i + 1 < outer.size(); ++i) {
+		offset = outer[i] - rB[0];
+		workspace.contacts_.find(rA, indexA, rB, offset, workspace.touchers_, workspace.touchingScratch_);
+
+		size_t before = allocations;
+		size_t checks = workspace.feasibleScratch_.predicateChecks_;
+		find_feasible_translation_vectors(rA, indexA, visitedA, rB, offset, indexB, workspace.touchers_, workspace.trimCache_, workspace.feasibleVectors_, workspace.feasibleScratch_);
+		if (workspace.feasibleScratch_.predicateChecks_ != checks) {
+			allocations = before;
+			++result.predicateSteps_;
+		}
+
+		if (!workspace.feasibleVectors_.empty()) {
+			TranslationVector next = select_next_translation_vector(nfp, nfpIndex, pA, rA, indexA, rB, offset, indexB, workspace.feasibleVectors_, workspace.history_, workspace.trimCache_, workspace.counted_);
+			workspace.trimCache_.trim(rA, indexA, rB, offset, indexB, next);
+			workspace.history_.push_back(next);
+			++result.steps_;
+		}
+		workspace.trimCache_.clear();
+	}
+	counting = false;
+	result.allocations_ = allocations;
+	return result;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		cerr << "Usage: alloccheck <case directory>..." << endl;
+		cerr << "Generates the NFP of the A.wkt and B.wkt of every case directory and replays the steps of the slide at every point of it" << endl;
+		cerr << "twice with the same workspace. Checks that the second replay doesn't allocate, apart from the steps whose feasibility filter" << endl;
+		cerr << "fell back to the boost predicates." << endl;
+		return 1;
+	}
+
+	bool allFree = true;
+	cout << left << setw(24) << "case" << right << setw(12) << "steps" << setw(12) << "predicates" << setw(12) << "warmup" << setw(12) << "reused" << endl;
+	for (int arg = 1; arg < argc; ++arg) {
+		string dir = argv[arg];
+		string name = dir.substr(dir.find_last_of('/', dir.size() - 2) + 1);
+		polygon_t pA;
+		polygon_t pB;
+		read_wkt_polygon(dir + "/A.wkt", pA);
+		read_wkt_polygon(dir + "/B.wkt", pB);
+
+		nfp_t nfp;
+		try {
+			nfp = generate_nfp(static_cast<const polygon_t&>(pA), static_cast<const polygon_t&>(pB), true);
+		} catch (std::exception& ex) {
+			cerr << name << ": " << ex.what() << endl;
+			cout << left << setw(24) << name << right << setw(12) << "failed" << endl;
+			continue;
+		}
+		if (nfp.empty() || nfp.front().size() < 2) {
+			cout << left << setw(24) << name << right << setw(12) << "empty" << endl;
+			continue;
+		}
+
+		const polygon_t::ring_type& ringA = pA.outer();
+		const polygon_t::ring_type& ringB = pB.outer();
+		SoaRing rA(ringA);
+		EdgeIndex indexA(ringA);
+		SoaRing rB(ringB);
+		EdgeIndex indexB(ringB);
+		NfpIndex nfpIndex;
+		nfpIndex.update(nfp);
+		std::vector<bool> visitedA(ringA.size(), false);
+		NfpWorkspace workspace;
+
+		ReplayResult warmup = replay(pA, rA, indexA, rB, indexB, nfp, nfpIndex, visitedA, workspace);
+		ReplayResult reused = replay(pA, rA, indexA, rB, indexB, nfp, nfpIndex, visitedA, workspace);
+
+		allFree = allFree && reused.allocations_ == 0;
+		cout << left << setw(24) << name << right << setw(12) << reused.steps_ << setw(12) << reused.predicateSteps_ << setw(12) << warmup.allocations_ << setw(12) << reused.allocations_ << endl;
+	}
+
+	return allFree ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+#include "bench_backend.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+void print_result(const BenchResult& r, const BenchResult& reference) {
+	if (!r.success_) {
+		cout << setw(12) << "failed" << setw(8) << "";
+		return;
+	}
+
+	cout << setw(12) << fixed << setprecision(3) << r.millis_ << setw(8) << (r.wkt_ == reference.wkt_ ? "same" : "differs");
+}
+
+void print_allocations(const BenchResult& r) {
+	if (!r.success_) {
+		cout << setw(20) << "failed";
+		return;
+	}
+
+	cout << setw(20) << r.gmpAllocations_;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		cerr << "Usage: bench [-r] [-a] <iterations> <case directory>..." << endl;
+		cerr << "Benchmarks the long double, double, grid, lazy rational and (with -r) rational backend on the A.wkt and B.wkt of every case directory." << endl;
+		cerr << "Prints the milliseconds per NFP and whether the NFP is the same as the one of the long double backend." << endl;
+		cerr << "With -a it also prints the number of GMP allocations per NFP of the rational backends." << endl;
+		return 1;
+	}
+
+	int arg = 1;
+	bool rational = false;
+	bool allocations = false;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+		if (strcmp(argv[arg], "-r") == 0)
+			rational = true;
+		else if (strcmp(argv[arg], "-a") == 0)
+			allocations = true;
+	}
+	size_t iterations = stoul(argv[arg++]);
+
+	cout << left << setw(24) << "case" << right << setw(20) << "long double" << setw(20) << "double" << setw(20) << "grid" << setw(20) << "lazy rational";
+	if (rational)
+		cout << setw(20) << "rational";
+	if (allocations) {
+		cout << setw(20) << "lazy allocs";
+		if (rational)
+			cout << setw(20) << "rational allocs";
+	}
+	cout << endl;
+
+	double total[5] = { 0, 0, 0, 0, 0 };
+	for (; arg < argc; ++arg) {
+		string dir = argv[arg];
+		string fileA = dir + "/A.wkt";
+		string fileB = dir + "/B.wkt";
+		string name = dir.substr(dir.find_last_of('/', dir.size() - 2) + 1);
+
+		BenchResult ld = bench_long_double(fileA, fileB, iterations);
+		BenchResult d = bench_double(fileA, fileB, iterations);
+		BenchResult g = bench_grid(fileA, fileB, iterations);
+		BenchResult lr = bench_lazy_rational(fileA, fileB, iterations);
+		cout << left << setw(24) << name << right;
+		print_result(ld, ld);
+		print_result(d, ld);
+		print_result(g, ld);
+		print_result(lr, ld);
+		total[0] += ld.millis_;
+		total[1] += d.millis_;
+		total[2] += g.millis_;
+		total[3] += lr.millis_;
+		BenchResult r;
+		if (rational) {
+			r = bench_rational(fileA, fileB, iterations);
+			print_result(r, ld);
+			total[4] += r.millis_;
+		}
+		if (allocations) {
+			print_allocations(lr);
+			if (rational)
+				print_allocations(r);
+		}
+		cout << endl;
+	}
+
+	cout << left << setw(24) << "total" << right << setw(12) << total[0] << setw(8) << "" << setw(12) << total[1] << setw(8) << "" << setw(12) << total[2] << setw(8) << "" << setw(12) << total[3] << setw(8) << "";
+	if (rational)
+		cout << setw(12) << total[4];
+	cout << endl;
+	return 0;
+}
@@ -0,0 +1,82 @@
+//the backend is selected by the Makefile, which also names the function via BENCH_FUNCTION
+#include "../src/libnfporb.hpp"
+#include "bench_backend.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+using namespace libnfporb;
+
+#ifdef LIBNFP_USE_RATIONAL
+namespace {
+//counts the allocations GMP makes through its memory functions
+size_t gmp_allocations = 0;
+void* (*gmp_alloc)(size_t);
+void* (*gmp_realloc)(void*, size_t, size_t);
+
+void* counting_alloc(size_t size) {
+	++gmp_allocations;
+	return gmp_alloc(size);
+}
+
+void* counting_realloc(void* ptr, size_t oldSize, size_t newSize) {
+	++gmp_allocations;
+	return gmp_realloc(ptr, oldSize, newSize);
+}
+
+size_t count_gmp_allocations(const polygon_t& pA, const polygon_t& pB) {
+	void (*gmp_free)(void*, size_t);
+	mp_get_memory_functions(&gmp_alloc, &gmp_realloc, &gmp_free);
+	mp_set_memory_functions(&counting_alloc, &counting_realloc, gmp_free);
+	gmp_allocations = 0;
+	generate_nfp(pA, pB, true);
+	mp_set_memory_functions(gmp_alloc, gmp_realloc, gmp_free);
+	return gmp_allocations;
+}
+}
+#endif
+
+BenchResult BENCH_FUNCTION(const std::string& fileA, const std::string& fileB, const size_t& iterations) {
+	BenchResult result;
+	polygon_t pA;
+	polygon_t pB;
+
+	try {
+		//the rational backend can't read decimals
+		read_wkt_polygon(fileA, pA);
+		read_wkt_polygon(fileB, pB);
+#ifdef LIBNFP_USE_GRID
+		snap_to_grid(pA, BENCH_GRID_RESOLUTION);
+		snap_to_grid(pB, BENCH_GRID_RESOLUTION);
+#endif
+
+		//the inputs are reused by every iteration
+		const polygon_t& cA = pA;
+		const polygon_t& cB = pB;
+
+		nfp_t nfp;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < iterations; ++i) {
+			nfp = generate_nfp(cA, cB, true);
+		}
+		auto end = std::chrono::steady_clock::now();
+		result.millis_ = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+#ifdef LIBNFP_USE_RATIONAL
+		result.gmpAllocations_ = count_gmp_allocations(cA, cB);
+#endif
+#ifdef LIBNFP_USE_GRID
+		scale_from_grid(nfp, BENCH_GRID_RESOLUTION);
+#endif
+
+		std::ostringstream ss;
+		for (const auto& ring : nfp) {
+			ss << std::setprecision(12) << bg::wkt(ring) << std::endl;
+		}
+		result.wkt_ = ss.str();
+		result.success_ = true;
+	} catch (std::exception& ex) {
+		result.error_ = ex.what();
+	}
+	return result;
+}
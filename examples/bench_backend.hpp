@@ -0,0 +1,30 @@
+#ifndef EXAMPLES_BENCH_BACKEND_HPP_
+#define EXAMPLES_BENCH_BACKEND_HPP_
+
+#include <string>
+
+/**
+ * The result of benchmarking one pair of polygons with one coordinate backend.
+ */
+struct BenchResult {
+	bool success_ = false;
+	std::string error_;
+	//the NFP as written by writeGolden
+	std::string wkt_;
+	double millis_ = 0;
+	//the number of GMP allocations of one NFP, only counted by the rational backends
+	size_t gmpAllocations_ = 0;
+};
+
+//the grid the input of bench_grid is snapped to. the test cases are integral, so they are on this grid already
+#define BENCH_GRID_RESOLUTION 1.0L
+
+//bench_backend.cpp is compiled once per coordinate backend, see the Makefile
+BenchResult bench_long_double(const std::string& fileA, const std::string& fileB, const size_t& iterations);
+BenchResult bench_double(const std::string& fileA, const std::string& fileB, const size_t& iterations);
+//snaps the input to a grid of BENCH_GRID_RESOLUTION
+BenchResult bench_grid(const std::string& fileA, const std::string& fileB, const size_t& iterations);
+BenchResult bench_lazy_rational(const std::string& fileA, const std::string& fileB, const size_t& iterations);
+BenchResult bench_rational(const std::string& fileA, const std::string& fileB, const size_t& iterations);
+
+#endif /* EXAMPLES_BENCH_BACKEND_HPP_ */
@@ -0,0 +1,87 @@
+#include "../src/libnfporb.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+
+using namespace libnfporb;
+using namespace std;
+
+struct CheckResult {
+	bool success_ = false;
+	string error_;
+	nfp_t nfp_;
+	double millis_ = 0;
+};
+
+CheckResult run(const PreparedPolygon& pA, const PreparedPolygon& pB, NfpWorkspace& workspace) {
+	CheckResult result;
+	auto start = chrono::steady_clock::now();
+	try {
+		result.nfp_ = generate_nfp(pA, pB, workspace);
+		result.success_ = true;
+	} catch (std::exception& ex) {
+		result.error_ = ex.what();
+	}
+	result.millis_ = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+/**
+ * @return true if both runs failed with the same error or both NFPs have exactly the same coordinates.
+ */
+bool identical(const CheckResult& lhs, const CheckResult& rhs) {
+	if (lhs.success_ != rhs.success_ || lhs.error_ != rhs.error_ || lhs.nfp_.size() != rhs.nfp_.size())
+		return false;
+
+	for (size_t r = 0; r < lhs.nfp_.size(); ++r) {
+		const auto& ringL = lhs.nfp_[r];
+		const auto& ringR = rhs.nfp_[r];
+		if (ringL.size() != ringR.size())
+			return false;
+
+		for (size_t i = 0; i < ringL.size(); ++i) {
+			if (!(ringL[i].x_ == ringR[i].x_) || !(ringL[i].y_ == ringR[i].y_))
+				return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		cerr << "Usage: enginecheck <case directory>..." << endl;
+		cerr << "Generates the NFP of the A.wkt and B.wkt of every case directory, once trimming with the ray scan and once with the" << endl;
+		cerr << "collision events, and checks that the NFPs are bit for bit the same." << endl;
+		return 1;
+	}
+
+	bool allIdentical = true;
+	NfpWorkspace scan;
+	NfpWorkspace events;
+	events.trimEngine_ = TRIM_EVENTS;
+
+	cout << left << setw(24) << "case" << right << setw(12) << "events" << setw(12) << "scan ms" << setw(12) << "events ms" << setw(12) << "collects" << setw(12) << "reuses" << endl;
+	for (int arg = 1; arg < argc; ++arg) {
+		string dir = argv[arg];
+		string name = dir.substr(dir.find_last_of('/', dir.size() - 2) + 1);
+		polygon_t pA;
+		polygon_t pB;
+		read_wkt_polygon(dir + "/A.wkt", pA);
+		read_wkt_polygon(dir + "/B.wkt", pB);
+		PreparedPolygon preparedA(pA, true);
+		PreparedPolygon preparedB(pB, true);
+
+		size_t collects = events.kinetic_.collects();
+		size_t reuses = events.kinetic_.reuses();
+		CheckResult reference = run(preparedA, preparedB, scan);
+		CheckResult result = run(preparedA, preparedB, events);
+		bool same = identical(reference, result);
+		allIdentical = allIdentical && same;
+		cout << left << setw(24) << name << right << setw(12) << (same ? "same" : "differs") << fixed << setprecision(2) << setw(12) << reference.millis_ << setw(12)
+				<< result.millis_ << setw(12) << events.kinetic_.collects() - collects << setw(12) << events.kinetic_.reuses() - reuses << endl;
+	}
+
+	return allIdentical ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+//the vectorized kernels only exist in the double backend
+#define LIBNFP_USE_DOUBLE
+#include "../src/libnfporb.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+using namespace libnfporb;
+using namespace std;
+
+struct CheckResult {
+	bool success_ = false;
+	string error_;
+	nfp_t nfp_;
+};
+
+CheckResult run(const polygon_t& pA, const polygon_t& pB) {
+	CheckResult result;
+	try {
+		result.nfp_ = generate_nfp(pA, pB, true);
+		result.success_ = true;
+	} catch (std::exception& ex) {
+		result.error_ = ex.what();
+	}
+	return result;
+}
+
+/**
+ * @return true if both runs failed with the same error or both NFPs have exactly the same coordinates.
+ */
+bool identical(const CheckResult& lhs, const CheckResult& rhs) {
+	if (lhs.success_ != rhs.success_ || lhs.error_ != rhs.error_ || lhs.nfp_.size() != rhs.nfp_.size())
+		return false;
+
+	for (size_t r = 0; r < lhs.nfp_.size(); ++r) {
+		const auto& ringL = lhs.nfp_[r];
+		const auto& ringR = rhs.nfp_[r];
+		if (ringL.size() != ringR.size())
+			return false;
+
+		for (size_t i = 0; i < ringL.size(); ++i) {
+			if (ringL[i].x_.val() != ringR[i].x_.val() || ringL[i].y_.val() != ringR[i].y_.val())
+				return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		cerr << "Usage: simdcheck <case directory>..." << endl;
+		cerr << "Generates the NFP of the A.wkt and B.wkt of every case directory with the double backend, once on the scalar path" << endl;
+		cerr << "and once with every vectorized kernel the CPU supports, and checks that the NFPs are bit for bit the same." << endl;
+		return 1;
+	}
+
+	const SimdLevel levels[] = { SIMD_AVX2, SIMD_AVX512 };
+	const char* names[] = { "avx2", "avx512" };
+	const SimdLevel supported = detect_simd_level();
+	bool allIdentical = true;
+
+	cout << left << setw(24) << "case" << right << setw(12) << names[0] << setw(12) << names[1] << endl;
+	for (int arg = 1; arg < argc; ++arg) {
+		string dir = argv[arg];
+		string name = dir.substr(dir.find_last_of('/', dir.size() - 2) + 1);
+		polygon_t pA;
+		polygon_t pB;
+		read_wkt_polygon(dir + "/A.wkt", pA);
+		read_wkt_polygon(dir + "/B.wkt", pB);
+
+		set_simd_level(SIMD_SCALAR);
+		CheckResult reference = run(pA, pB);
+
+		cout << left << setw(24) << name << right;
+		for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); ++i) {
+			if (levels[i] > supported) {
+				cout << setw(12) << "unsupported";
+				continue;
+			}
+
+			set_simd_level(levels[i]);
+			bool same = identical(reference, run(pA, pB));
+			allIdentical = allIdentical && same;
+			cout << setw(12) << (same ? "same" : "differs");
+		}
+		cout << endl;
+	}
+
+	set_simd_level(supported);
+	return allIdentical ? 0 : 1;
+}
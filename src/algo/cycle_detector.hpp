@@ -0,0 +1,70 @@
+#ifndef SRC_ALGO_CYCLE_DETECTOR_HPP_
+#define SRC_ALGO_CYCLE_DETECTOR_HPP_
+
+#include "../geometry.hpp"
+#include "../translation_vector.hpp"
+#include "../history.hpp"
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+/**
+ * @brief Detects a slide that is about to walk the same lap of translations a third time.
+ * A lap of p translations is confirmed when the last 2p translations are the same lap twice, B is back where the lap started both times
+ * and the next translation would start it once more. The laps are compared by the rolling hash of the %History first and verified after.
+ * The repetitions %delete_consecutive_repeating_point_patterns removes from the finished NFP are laps walked twice, which the slide left on its own.
+ */
+class CycleDetector {
+	size_t cycles_ = 0;
+	size_t saved_ = 0;
+public:
+	/**
+	 * @brief Check whether the next translation would walk a lap a third time.
+	 * @param history The translations of the slide so far.
+	 * @param path The positions of the reference point of B during the slide, one more than there are translations in the history.
+	 * @param next The translation the slide selected next.
+	 * @return The number of translations of the lap, or 0 if there is no confirmed cycle.
+	 */
+	size_t detect(const History& history, const polygon_t::ring_type& path, const TranslationVector& next) {
+		const size_t n = history.size();
+		if (n < 4 || path.size() != n + 1)
+			return 0;
+
+		//the next translation starts the lap again if it equals the first translation of the last lap
+		for (off_t i = history.find(next, n - n / 2); i != -1 && size_t(i) + 2 <= n; i = history.find(next, i + 1)) {
+			const size_t p = n - i;
+			if (history.hash(n - 2 * p, n - p) != history.hash(n - p, n))
+				continue;
+			if (!equals(path[n], path[n - p]) || !equals(path[n - p], path[n - 2 * p]))
+				continue;
+
+			bool same = true;
+			for (size_t k = 0; same && k < p; ++k) {
+				same = history[n - 2 * p + k] == history[n - p + k];
+			}
+			if (same) {
+				++cycles_;
+				saved_ += p;
+				return p;
+			}
+		}
+		return 0;
+	}
+
+	/**
+	 * @return How many cycles were detected.
+	 */
+	size_t cycles() const {
+		return cycles_;
+	}
+
+	/**
+	 * @return The number of steps of the laps that weren't walked again.
+	 */
+	size_t saved() const {
+		return saved_;
+	}
+};
+}
+}
+
+#endif /* SRC_ALGO_CYCLE_DETECTOR_HPP_ */
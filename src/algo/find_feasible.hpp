@@ -3,47 +3,87 @@
 
 #include "../geometry.hpp"
 #include "../translation_vector.hpp"
-#include "trim_vector.hpp"
+#include "../soa_ring.hpp"
+#include "trim_cache.hpp"
 #include "touching_point.hpp"
 
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+/**
+ * Compare the angles between an edge and two directions on the same side of it without calculating the angles:
+ * the direction that is rotated further away from the edge has the larger angle.
+ * Rationals and grid coordinates are compared exactly. The floating point backends treat directions as equal when the sine of the angle between them is within %NFP_EPSILON.
+ * @param first The first direction
+ * @param second The second direction
+ * @param side The orientation of both directions relative to the edge
+ * @return > 0 if the angle to second is larger, < 0 if the angle to first is larger and 0 if they are the same
+ */
+int compare_angles(const point_t& first, const point_t& second, int side) {
+	static const point_t origin;
+#if !defined(LIBNFP_USE_RATIONAL) && !defined(LIBNFP_USE_GRID)
+	const long double fx = toLongDouble(first.x_), fy = toLongDouble(first.y_), sx = toLongDouble(second.x_), sy = toLongDouble(second.y_);
+	const long double cross = fx * sy - fy * sx;
+	if (cross * cross <= NFP_EPSILON * NFP_EPSILON * (fx * fx + fy * fy) * (sx * sx + sy * sy))
+		return 0;
+#endif
+	return orientation(origin, first, second) * side;
+}
+
+/**
+ * @brief The scratch buffers of %find_feasible_translation_vectors. Reusing them across calls avoids allocating them in every slide step.
+ */
+struct FeasibleScratch {
+	std::vector<TranslationVector> potentialVectors_;
+	//the directions of the touching edges, the first one of every pair belongs to A
+	std::vector<std::pair<point_t, point_t>> touchDirections_;
+	//ring B at its current and at its trimmed position, for the candidates the angles can't decide
+	polygon_t::ring_type current_;
+	polygon_t::ring_type translated_;
+	//the number of candidates that were decided by the boost predicates. Those allocate internally.
+	size_t predicateChecks_ = 0;
+};
+
 /**
  * From all touching points derive all translations that lead to a valid slide, including already traversed ones
  * @param ringA Ring of A
- * @param ringB Ring of B
+ * @param indexA The %EdgeIndex of ringA
+ * @param visitedA The visitation state of the vertices of ringA. The touching vertices are marked as visited.
+ * @param ringB Ring of B in local coordinates
+ * @param offsetB The current translation of ringB
+ * @param indexB The %EdgeIndex of ringB in local coordinates
  * @param touchers %std::vector of TouchingPoints (probably generated by "find_touching_points")
- * @return The feasible translation vectors
+ * @param trimCache The %TrimCache of the current step.
+ * @param vectors Receives the feasible translation vectors. Cleared first.
+ * @param scratch The scratch buffers. Their content is overwritten.
  */
-std::vector<TranslationVector> find_feasible_translation_vectors(polygon_t::ring_type& ringA, polygon_t::ring_type& ringB, const std::vector<TouchingPoint>& touchers) {
-	//use a set to automatically filter duplicate vectors
-	std::vector<TranslationVector> potentialVectors;
-	std::vector<std::pair<segment_t, segment_t>> touchEdges;
+void find_feasible_translation_vectors(const SoaRing& ringA, const EdgeIndex& indexA, std::vector<bool>& visitedA, const SoaRing& ringB, const point_t& offsetB, const EdgeIndex& indexB, const std::vector<TouchingPoint>& touchers, TrimCache& trimCache, std::vector<TranslationVector>& vectors, FeasibleScratch& scratch) {
+	std::vector<TranslationVector>& potentialVectors = scratch.potentialVectors_;
+	//the edges of A are taken from its precomputed edge directions. B is translated, so its directions are calculated from the translated points,
+	//which is the geometry every other predicate sees.
+	std::vector<std::pair<point_t, point_t>>& touchDirections = scratch.touchDirections_;
+	potentialVectors.clear();
+	touchDirections.clear();
+	vectors.clear();
+	point_t vertexA;
+	point_t prevA;
+	point_t nextA;
+	point_t vertexB;
+	point_t prevB;
+	point_t nextB;
 
 	for (psize_t i = 0; i < touchers.size(); i++) {
-		point_t& vertexA = ringA[touchers[i].A_];
-		vertexA.marked_ = true;
+		const psize_t& iA = touchers[i].A_;
+		const psize_t& iB = touchers[i].B_;
+		visitedA[iA] = true;
 
-		// adjacent A vertices
-		signed long prevAindex = touchers[i].A_ - 1;
-		signed long nextAindex = touchers[i].A_ + 1;
+		//the rings are padded, so the adjacent vertices of the first and of the closing point need no wrap-around
+		ringA.get(iA, vertexA);
+		ringA.get_prev(iA, prevA);
+		ringA.get_next(iA, nextA);
 
-		prevAindex = (prevAindex < 0) ? ringA.size() - 2 : prevAindex; // loop
-		nextAindex = (static_cast<psize_t>(nextAindex) >= ringA.size()) ? 1 : nextAindex; // loop
-
-		point_t& prevA = ringA[prevAindex];
-		point_t& nextA = ringA[nextAindex];
-
-		// adjacent B vertices
-		point_t& vertexB = ringB[touchers[i].B_];
-
-		signed long prevBindex = touchers[i].B_ - 1;
-		signed long nextBindex = touchers[i].B_ + 1;
-
-		prevBindex = (prevBindex < 0) ? ringB.size() - 2 : prevBindex; // loop
-		nextBindex = (static_cast<psize_t>(nextBindex) >= ringB.size()) ? 1 : nextBindex; // loop
-
-		point_t& prevB = ringB[prevBindex];
-		point_t& nextB = ringB[nextBindex];
+		ringB.translated(iB, offsetB, vertexB);
+		ringB.translated_prev(iB, offsetB, prevB);
+		ringB.translated_next(iB, offsetB, nextB);
 
 		if (touchers[i].type_ == TouchingPoint::VERTEX) {
 			segment_t a1 = { vertexA, nextA };
@@ -51,12 +91,16 @@ std::vector<TranslationVector> find_feasible_translation_vectors(polygon_t::ring
 			segment_t b1 = { vertexB, nextB };
 			segment_t b2 = { vertexB, prevB };
 
-			//swap the segment elements so that always the first point is the touching point
-			//also make the second segment always a segment of ringB
-			touchEdges.push_back( { a1, b1 });
-			touchEdges.push_back( { a1, b2 });
-			touchEdges.push_back( { a2, b1 });
-			touchEdges.push_back( { a2, b2 });
+			//the first point of every touching edge is the touching point
+			//the second edge is always an edge of ringB
+			const point_t dirA1 = ringA.outgoing(iA);
+			const point_t dirA2 = flip(ringA.incoming(iA));
+			const point_t dirB1 = nextB - vertexB;
+			const point_t dirB2 = prevB - vertexB;
+			touchDirections.push_back( { dirA1, dirB1 });
+			touchDirections.push_back( { dirA1, dirB2 });
+			touchDirections.push_back( { dirA2, dirB1 });
+			touchDirections.push_back( { dirA2, dirB2 });
 #ifdef NFP_DEBUG
 			write_svg("touchersV" + std::to_string(i) + ".svg", {a1,a2,b1,b2});
 #endif
@@ -66,11 +110,11 @@ std::vector<TranslationVector> find_feasible_translation_vectors(polygon_t::ring
 			//a1 and b1 meet at start vertex
 			al = get_alignment(a1, b1.second);
 			if (al == LEFT) {
-				potentialVectors.push_back( { b1.first - b1.second, b1, false, "vertex1" });
+				potentialVectors.push_back( { b1.first - b1.second, b1, false, TranslationVector::VERTEX1 });
 			} else if (al == RIGHT) {
-				potentialVectors.push_back( { a1.second - a1.first, a1, true, "vertex2" });
+				potentialVectors.push_back( { a1.second - a1.first, a1, true, TranslationVector::VERTEX2 });
 			} else {
-				potentialVectors.push_back( { a1.second - a1.first, a1, true, "vertex3" });
+				potentialVectors.push_back( { a1.second - a1.first, a1, true, TranslationVector::VERTEX3 });
 			}
 
 			//a1 and b2 meet at start and end
@@ -79,57 +123,64 @@ std::vector<TranslationVector> find_feasible_translation_vectors(polygon_t::ring
 				//no feasible translation
 				DEBUG_MSG("not feasible", a1.second - a1.first);
 			} else if (al == RIGHT) {
-				potentialVectors.push_back( { a1.second - a1.first, a1, true, "vertex5" });
+				potentialVectors.push_back( { a1.second - a1.first, a1, true, TranslationVector::VERTEX5 });
 			} else {
-				potentialVectors.push_back( { a1.second - a1.first, a1, true, "vertex6" });
+				potentialVectors.push_back( { a1.second - a1.first, a1, true, TranslationVector::VERTEX6 });
 			}
 
 			//a2 and b1 meet at end and start
 			al = get_alignment(a2, b1.second);
 			if (al == LEFT) {
-				potentialVectors.push_back( { b1.first - b1.second, b1, false, "vertex7" });
+				potentialVectors.push_back( { b1.first - b1.second, b1, false, TranslationVector::VERTEX7 });
 			} else if (al == RIGHT) {
-				potentialVectors.push_back( { b1.first - b1.second, b1, false, "vertex8" });
+				potentialVectors.push_back( { b1.first - b1.second, b1, false, TranslationVector::VERTEX8 });
 			} else {
-				potentialVectors.push_back( { b1.first - b1.second, b1, false, "vertex9" });
+				potentialVectors.push_back( { b1.first - b1.second, b1, false, TranslationVector::VERTEX9 });
 			}
 		} else if (touchers[i].type_ == TouchingPoint::B_ON_A) {
+			const point_t dirA1 = vertexA - vertexB;
+			const point_t dirA2 = prevA - vertexB;
+			const point_t dirB1 = prevB - vertexB;
+			const point_t dirB2 = nextB - vertexB;
+			touchDirections.push_back( { dirA1, dirB1 });
+			touchDirections.push_back( { dirA1, dirB2 });
+			touchDirections.push_back( { dirA2, dirB1 });
+			touchDirections.push_back( { dirA2, dirB2 });
+#ifdef NFP_DEBUG
 			segment_t a1 = { vertexB, vertexA };
 			segment_t a2 = { vertexB, prevA };
 			segment_t b1 = { vertexB, prevB };
 			segment_t b2 = { vertexB, nextB };
-
-			touchEdges.push_back( { a1, b1 });
-			touchEdges.push_back( { a1, b2 });
-			touchEdges.push_back( { a2, b1 });
-			touchEdges.push_back( { a2, b2 });
-#ifdef NFP_DEBUG
 			write_svg("touchersB" + std::to_string(i) + ".svg", {a1,a2,b1,b2});
 #endif
-			potentialVectors.push_back( { vertexA - vertexB, { vertexB, vertexA }, true, "bona" });
+			potentialVectors.push_back( { vertexA - vertexB, { vertexB, vertexA }, true, TranslationVector::BONA });
 		} else if (touchers[i].type_ == TouchingPoint::A_ON_B) {
 			//TODO testme
+#ifdef NFP_DEBUG
 			segment_t a1 = { vertexA, prevA };
 			segment_t a2 = { vertexA, nextA };
 			segment_t b1 = { vertexA, vertexB };
 			segment_t b2 = { vertexA, prevB };
-#ifdef NFP_DEBUG
 			write_svg("touchersA" + std::to_string(i) + ".svg", {a1,a2,b1,b2});
 #endif
-			touchEdges.push_back( { a1, b1 });
-			touchEdges.push_back( { a2, b1 });
-			touchEdges.push_back( { a1, b2 });
-			touchEdges.push_back( { a2, b2 });
-			potentialVectors.push_back( { vertexA - vertexB, { vertexA, vertexB }, false, "aonb" });
+			const point_t dirA1 = flip(ringA.incoming(iA));
+			const point_t dirA2 = ringA.outgoing(iA);
+			const point_t dirB1 = vertexB - vertexA;
+			const point_t dirB2 = prevB - vertexA;
+			touchDirections.push_back( { dirA1, dirB1 });
+			touchDirections.push_back( { dirA2, dirB1 });
+			touchDirections.push_back( { dirA1, dirB2 });
+			touchDirections.push_back( { dirA2, dirB2 });
+			potentialVectors.push_back( { vertexA - vertexB, { vertexA, vertexB }, false, TranslationVector::AONB });
 		}
 	}
 
 #ifdef NFP_DEBUG
-	DEBUG_VAL("touching edges:");
+	DEBUG_VAL("touching edge directions:");
 	std::stringstream ss;
 
-	for(const auto& te: touchEdges) {
-		ss << te.first << " (" << (te.first.second - te.first.first) << ") <-> " << te.second << " (" << (te.second.second - te.second.first) << ')';
+	for(const auto& td: touchDirections) {
+		ss << td.first << " <-> " << td.second;
 		DEBUG_VAL(ss.str());
 		ss.str("");
 	}
@@ -141,47 +192,53 @@ std::vector<TranslationVector> find_feasible_translation_vectors(polygon_t::ring
 	}
 	DEBUG_VAL("");
 #endif
-	//discard immediately intersecting translations
-	std::vector<TranslationVector> vectors;
+	//discard immediately intersecting translations.
+	//the angles between the edge of a candidate and the touching edges are compared with orientations only, so no sqrt or acos is involved
+	const point_t origin;
 	for (const auto& v : potentialVectors) {
 		bool discarded = false;
-		for (const auto& sp : touchEdges) {
-			point_t normEdge = normalize(v.edge_.second - v.edge_.first);
-			point_t normFirst = normalize(sp.first.second - sp.first.first);
-			point_t normSecond = normalize(sp.second.second - sp.second.first);
-
-			Alignment a1 = get_alignment( { { 0, 0 }, normEdge }, normFirst);
-			Alignment a2 = get_alignment( { { 0, 0 }, normEdge }, normSecond);
-
-			if (a1 == a2 && a1 != ON) {
-				LongDouble df = get_inner_angle( { 0, 0 }, normEdge, normFirst);
-				LongDouble ds = get_inner_angle( { 0, 0 }, normEdge, normSecond);
-
-				point_t normIn = normalize(v.edge_.second - v.edge_.first);
-				if (equals(df, ds)) {
-					TranslationVector trimmed = trim_vector(ringA, ringB, v);
-					polygon_t::ring_type translated;
+		const point_t edgeDirection = v.edge_.second - v.edge_.first;
+		//the vector is either the direction of the edge or its reverse
+		const bool alongEdge = !(v.vector_.x_ * edgeDirection.x_ + v.vector_.y_ * edgeDirection.y_ < 0);
+
+		for (const auto& sd : touchDirections) {
+			int sideFirst = orientation(origin, edgeDirection, sd.first);
+			int sideSecond = orientation(origin, edgeDirection, sd.second);
+
+			if (sideFirst == sideSecond && sideFirst != 0) {
+				int angleOrder = compare_angles(sd.first, sd.second, sideFirst);
+
+				if (angleOrder == 0) {
+					++scratch.predicateChecks_;
+					TranslationVector trimmed = trimCache.trim(ringA, indexA, ringB, offsetB, indexB, v);
+					const polygon_t::ring_type& rA = ringA.ring();
+					polygon_t::ring_type& current = scratch.current_;
+					polygon_t::ring_type& translated = scratch.translated_;
+					ringB.materialize(offsetB, current);
 					trans::translate_transformer<coord_t, 2, 2> translate(trimmed.vector_.x_, trimmed.vector_.y_);
-					boost::geometry::transform(ringB, translated, translate);
-//					DEBUG_MSG("intersects", bg::intersects(translated, ringA));
-//					DEBUG_MSG("overlaps", bg::overlaps(translated, ringA));
-//					DEBUG_MSG("covered_byL", bg::covered_by(translated, ringA));
-//					DEBUG_MSG("covered_byR", bg::covered_by(ringA, translated));
+					//transform appends to a ring
+					translated.clear();
+					boost::geometry::transform(current, translated, translate);
+//					DEBUG_MSG("intersects", bg::intersects(translated, rA));
+//					DEBUG_MSG("overlaps", bg::overlaps(translated, rA));
+//					DEBUG_MSG("covered_byL", bg::covered_by(translated, rA));
+//					DEBUG_MSG("covered_byR", bg::covered_by(rA, translated));
 
-					if (!(bg::intersects(translated, ringA) && !bg::overlaps(translated, ringA) && !bg::covered_by(translated, ringA) && !bg::covered_by(ringA, translated))) {
+					if (!(bg::intersects(translated, rA) && !bg::overlaps(translated, rA) && !bg::covered_by(translated, rA) && !bg::covered_by(rA, translated))) {
 						DEBUG_MSG("discarded0", v);
 						discarded = true;
 						break;
 					}
 				} else {
-					if (equals(normIn, normalize(v.vector_))) {
-						if (!equals(df, 0) && larger(ds, df)) {
+					//neither angle can be zero, because neither touching edge is collinear with the edge
+					if (alongEdge) {
+						if (angleOrder > 0) {
 							DEBUG_MSG("discarded1", v);
 							discarded = true;
 							break;
 						}
 					} else {
-						if (!equals(ds, 0) && smaller(ds, df)) {
+						if (angleOrder < 0) {
 							DEBUG_MSG("discarded2", v);
 							discarded = true;
 							break;
@@ -194,10 +251,29 @@ std::vector<TranslationVector> find_feasible_translation_vectors(polygon_t::ring
 			vectors.push_back(v);
 		}
 	}
+}
+
+/**
+ * From all touching points derive all translations that lead to a valid slide, including already traversed ones
+ * @param ringA Ring of A
+ * @param indexA The %EdgeIndex of ringA
+ * @param visitedA The visitation state of the vertices of ringA. The touching vertices are marked as visited.
+ * @param ringB Ring of B in local coordinates
+ * @param offsetB The current translation of ringB
+ * @param indexB The %EdgeIndex of ringB in local coordinates
+ * @param touchers %std::vector of TouchingPoints (probably generated by "find_touching_points")
+ * @param trimCache The %TrimCache of the current step.
+ * @return The feasible translation vectors
+ */
+std::vector<TranslationVector> find_feasible_translation_vectors(const SoaRing& ringA, const EdgeIndex& indexA, std::vector<bool>& visitedA, const SoaRing& ringB, const point_t& offsetB, const EdgeIndex& indexB, const std::vector<TouchingPoint>& touchers, TrimCache& trimCache) {
+	std::vector<TranslationVector> vectors;
+	FeasibleScratch scratch;
+	find_feasible_translation_vectors(ringA, indexA, visitedA, ringB, offsetB, indexB, touchers, trimCache, vectors, scratch);
 	return vectors;
 }
 
 }
+}
 
 
 #endif /* SRC_ALGO_FIND_FEASIBLE_HPP_ */
@@ -0,0 +1,346 @@
+#ifndef SRC_ALGO_KINETIC_TRIM_HPP_
+#define SRC_ALGO_KINETIC_TRIM_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "../geometry.hpp"
+#include "../translation_vector.hpp"
+#include "../edge_index.hpp"
+#include "../soa_ring.hpp"
+#include "trim_vector.hpp"
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+
+/**
+ * @brief How %TrimCache trims a translation vector it hasn't seen in the current step.
+ */
+enum TrimEngine {
+	TRIM_SCAN,  //!< cast the rays of all vertices through the edge indexes (%trim_vector)
+	TRIM_EVENTS //!< advance through the collision events collected for the direction (%KineticEngine)
+};
+
+/**
+ * @brief A vertex that may hit an edge while B translates along the direction the event was collected for.
+ */
+struct CollisionEvent {
+	//lower bound of the distance B has to travel along the direction, from where the events were collected, until the vertex hits the edge
+	long double time_;
+	//upper bound of that distance. Once B travelled further, the edge lies behind the vertex
+	long double until_;
+	//the position of the pair in the order %trim_vector tests them
+	size_t order_;
+	//0: a vertex of A hits an edge of B, 1: a vertex of B hits an edge of A
+	uint8_t phase_;
+	psize_t vertex_;
+	psize_t edge_;
+};
+
+/**
+ * @brief Trims translation vectors from a queue of collision events instead of casting the rays of all vertices every time.
+ * For a direction the vertex/edge pairs that can collide while B moves up to twice the length of the vector are collected once, ordered by the
+ * distance at which they can collide at the earliest. As long as B keeps moving along that direction, the pairs don't change and the distances
+ * only shrink by the distance travelled, so a trim only intersects the pairs up to the nearest hit. Moving in any other direction invalidates the
+ * events of a direction. The events of a few directions are kept, as the feasibility filter trims candidates in several directions per step.
+ * The hits found are accepted in the order of %trim_vector with the same comparisons, so the result is the same as the one of %trim_vector.
+ */
+class KineticEngine {
+	static constexpr size_t SLOTS = 4;
+
+	struct slot_t {
+		//unit vector of the direction
+		long double ux_ = 0;
+		long double uy_ = 0;
+		//the distance the events cover
+		long double horizon_ = 0;
+		//the distance B travelled along the direction since the events were collected
+		long double travelled_ = 0;
+		//the distance B moved across the direction since the events were collected
+		long double drift_ = 0;
+		//covers the rounding of the distances and of the translated points
+		long double margin_ = 0;
+		std::vector<CollisionEvent> events_;
+		bool valid_ = false;
+	};
+
+	struct hit_t {
+		size_t order_;
+		uint8_t phase_;
+		size_t cnt_;
+		point_t pt_;
+		point_t hits_[2];
+		coord_t lens_[2];
+	};
+
+	slot_t slots_[SLOTS];
+	//the slot that is collected next if no slot matches
+	size_t next_ = 0;
+	//scratch buffers
+	std::vector<hit_t> hits_;
+	std::vector<long double> ax_;
+	std::vector<long double> ay_;
+	std::vector<long double> bx_;
+	std::vector<long double> by_;
+	size_t collects_ = 0;
+	size_t reuses_ = 0;
+	size_t tests_ = 0;
+
+	static void grow(boxf_t& box, const long double& margin) {
+		box.min_corner().x(box.min_corner().x() - margin);
+		box.min_corner().y(box.min_corner().y() - margin);
+		box.max_corner().x(box.max_corner().x() + margin);
+		box.max_corner().y(box.max_corner().y() + margin);
+	}
+
+	/**
+	 * @return A valid slot that can trim the translation vector, or nullptr.
+	 */
+	slot_t* find(const point_t& vec) {
+		const long double vx = toLongDouble(vec.x_);
+		const long double vy = toLongDouble(vec.y_);
+		for (slot_t& slot : slots_) {
+			if (!slot.valid_)
+				continue;
+			const long double along = vx * slot.ux_ + vy * slot.uy_;
+			const long double across = std::fabs(vx * slot.uy_ - vy * slot.ux_);
+			if (along > 0 && slot.travelled_ + along <= slot.horizon_ - slot.margin_ && slot.drift_ + across <= slot.margin_ / 2)
+				return &slot;
+		}
+		return nullptr;
+	}
+
+	/**
+	 * @brief Collect the events of the direction of vec into a slot, at the current translation of rB.
+	 */
+	void collect(slot_t& slot, const SoaRing& rA, const EdgeIndex& indexA, const SoaRing& rB, const point_t& offsetB, const EdgeIndex& indexB, const point_t& vec) {
+		const long double offX = toLongDouble(offsetB.x_);
+		const long double offY = toLongDouble(offsetB.y_);
+		long double magnitude = 1;
+		ax_.resize(rA.size());
+		ay_.resize(rA.size());
+		bx_.resize(rB.size());
+		by_.resize(rB.size());
+		for (psize_t i = 0; i < rA.size(); ++i) {
+			ax_[i] = toLongDouble(rA.xs()[i]);
+			ay_[i] = toLongDouble(rA.ys()[i]);
+			magnitude = std::max({ magnitude, std::fabs(ax_[i]), std::fabs(ay_[i]) });
+		}
+		for (psize_t i = 0; i < rB.size(); ++i) {
+			bx_[i] = toLongDouble(rB.xs()[i]) + offX;
+			by_[i] = toLongDouble(rB.ys()[i]) + offY;
+			magnitude = std::max({ magnitude, std::fabs(bx_[i]), std::fabs(by_[i]) });
+		}
+
+		const long double vx = toLongDouble(vec.x_);
+		const long double vy = toLongDouble(vec.y_);
+		const long double len = std::sqrt(vx * vx + vy * vy);
+		slot.ux_ = vx / len;
+		slot.uy_ = vy / len;
+		slot.horizon_ = 2 * len;
+		slot.travelled_ = 0;
+		slot.drift_ = 0;
+		slot.margin_ = 16 * NFP_EPSILON * magnitude;
+		slot.events_.clear();
+
+		const point_t span = vec + vec;
+		const point_t inverse = flip(span);
+		const long double ux = slot.ux_;
+		const long double uy = slot.uy_;
+		size_t order = 0;
+		point_t pt;
+		point_t local;
+
+		//same order as trim_vector: the vertices of A cast against the edges of B in the opposite direction, then the vertices of B against the edges of A
+		for (psize_t i = 0; i + 1 < rA.size(); ++i) {
+			rA.get(i, pt);
+			local = pt - offsetB;
+			boxf_t box = make_box(local, local + inverse);
+			grow(box, slot.margin_);
+			indexB.for_each(box, [&](const psize_t& j) {
+				const long double d1 = (ax_[i] - bx_[j]) * ux + (ay_[i] - by_[j]) * uy;
+				const long double d2 = (ax_[i] - bx_[j + 1]) * ux + (ay_[i] - by_[j + 1]) * uy;
+				slot.events_.push_back( { std::min(d1, d2), std::max(d1, d2), order++, 0, i, j });
+			});
+		}
+
+		for (psize_t i = 0; i + 1 < rB.size(); ++i) {
+			rB.translated(i, offsetB, pt);
+			boxf_t box = make_box(pt, pt + span);
+			grow(box, slot.margin_);
+			indexA.for_each(box, [&](const psize_t& j) {
+				const long double d1 = (ax_[j] - bx_[i]) * ux + (ay_[j] - by_[i]) * uy;
+				const long double d2 = (ax_[j + 1] - bx_[i]) * ux + (ay_[j + 1] - by_[i]) * uy;
+				slot.events_.push_back( { std::min(d1, d2), std::max(d1, d2), order++, 1, i, j });
+			});
+		}
+
+		std::sort(slot.events_.begin(), slot.events_.end(), [](const CollisionEvent& lhs, const CollisionEvent& rhs) {
+			return lhs.time_ < rhs.time_;
+		});
+		slot.valid_ = true;
+	}
+public:
+	/**
+	 * @brief Forget the events of all directions. Has to be called whenever one of the rings changes, e.g. when a new slide starts.
+	 */
+	void reset() {
+		for (slot_t& slot : slots_) {
+			slot.events_.clear();
+			slot.valid_ = false;
+		}
+	}
+
+	/**
+	 * @brief Tell the engine that B moved. The events of a direction stay valid if B moved along it.
+	 * @param vec The translation of B.
+	 */
+	void advance(const point_t& vec) {
+		const long double vx = toLongDouble(vec.x_);
+		const long double vy = toLongDouble(vec.y_);
+		for (slot_t& slot : slots_) {
+			if (!slot.valid_)
+				continue;
+			const long double along = vx * slot.ux_ + vy * slot.uy_;
+			const long double across = std::fabs(vx * slot.uy_ - vy * slot.ux_);
+			if (along > 0 && slot.drift_ + across <= slot.margin_ / 2) {
+				slot.travelled_ += along;
+				slot.drift_ += across;
+			} else {
+				slot.valid_ = false;
+			}
+		}
+	}
+
+	/**
+	 * @brief Trim a given translation vector so that it doesn't intersect with either rA or rB. Same as %trim_vector.
+	 * @param rA Ring of A.
+	 * @param indexA The %EdgeIndex of rA.
+	 * @param rB Ring of B in local coordinates.
+	 * @param offsetB The current translation of rB.
+	 * @param indexB The %EdgeIndex of rB in local coordinates.
+	 * @param tv The given translation vector
+	 * @return The trimmed translation vector
+	 */
+	TranslationVector trim(const SoaRing& rA, const EdgeIndex& indexA, const SoaRing& rB, const point_t& offsetB, const EdgeIndex& indexB, const TranslationVector& tv) {
+		static const coord_t epsilon = NFP_EPSILON;
+		static const point_t origin;
+		slot_t* slot = find(tv.vector_);
+		if (slot == nullptr) {
+			slot = &slots_[next_];
+			next_ = (next_ + 1) % SLOTS;
+			collect(*slot, rA, indexA, rB, offsetB, indexB, tv.vector_);
+			++collects_;
+		} else {
+			++reuses_;
+		}
+
+		const point_t inverse = flip(tv.vector_);
+		coord_t shortest = bg::length(tv.edge_);
+		long double bound = toLongDouble(shortest);
+		point_t local;
+		point_t q1;
+		point_t q2;
+		hits_.clear();
+
+		//intersect the pairs in the order of their earliest collision until no pair can collide before the nearest hit
+		for (const CollisionEvent& e : slot->events_) {
+			if (e.time_ - slot->travelled_ - slot->margin_ > bound * (1 + 1e-6L))
+				break;
+			if (e.until_ + slot->margin_ < slot->travelled_)
+				continue;
+
+			hits_.emplace_back();
+			hit_t& h = hits_.back();
+			h.order_ = e.order_;
+			h.phase_ = e.phase_;
+			//only the edges trim_vector queries from the edge indexes are considered
+			if (e.phase_ == 0) {
+				rA.get(e.vertex_, h.pt_);
+				local = h.pt_ - offsetB;
+				rB.get(e.edge_, q1);
+				rB.get_next(e.edge_, q2);
+				h.cnt_ = bg::intersects(make_box(local, local + inverse), make_box(q1, q2)) ? 1 : 0;
+				if (h.cnt_ > 0) {
+					rB.translated(e.edge_, offsetB, q1);
+					rB.translated(e.edge_ + 1, offsetB, q2);
+					h.cnt_ = intersect_translation(h.pt_, inverse, q1, q2, h.hits_);
+				}
+			} else {
+				rB.translated(e.vertex_, offsetB, h.pt_);
+				local = h.pt_ - origin;
+				rA.get(e.edge_, q1);
+				rA.get_next(e.edge_, q2);
+				h.cnt_ = bg::intersects(make_box(local, local + tv.vector_), make_box(q1, q2)) ? 1 : 0;
+				if (h.cnt_ > 0) {
+					rA.translated(e.edge_, origin, q1);
+					rA.translated(e.edge_ + 1, origin, q2);
+					h.cnt_ = intersect_translation(h.pt_, tv.vector_, q1, q2, h.hits_);
+				}
+			}
+			++tests_;
+
+			for (size_t k = 0; k < h.cnt_; ++k) {
+				assign_length(h.lens_[k], h.pt_, h.hits_[k]);
+				if (smaller(epsilon, h.lens_[k]))
+					bound = std::min(bound, toLongDouble(h.lens_[k]));
+			}
+			if (h.cnt_ == 0)
+				hits_.pop_back();
+		}
+
+		//accept the hits in the order of trim_vector
+		std::sort(hits_.begin(), hits_.end(), [](const hit_t& lhs, const hit_t& rhs) {
+			return lhs.order_ < rhs.order_;
+		});
+		TranslationVector trimmed = tv;
+		for (const hit_t& h : hits_) {
+			for (size_t k = 0; k < h.cnt_; ++k) {
+				if (smaller(epsilon, h.lens_[k]) && smaller(h.lens_[k], shortest)) {
+					shortest = h.lens_[k];
+					if (h.phase_ == 0)
+						trimmed.vector_ = h.pt_ - h.hits_[k];
+					else
+						trimmed.vector_ = h.hits_[k] - h.pt_;
+					trimmed.edge_ = segment_t(h.pt_, h.hits_[k]);
+				}
+			}
+		}
+
+#ifdef NFP_DEBUG
+		TranslationVector scanned = trim_vector(rA, indexA, rB, offsetB, indexB, tv);
+		if (!(scanned.vector_.x_ == trimmed.vector_.x_ && scanned.vector_.y_ == trimmed.vector_.y_ && scanned.edge_.first.x_ == trimmed.edge_.first.x_
+				&& scanned.edge_.first.y_ == trimmed.edge_.first.y_ && scanned.edge_.second.x_ == trimmed.edge_.second.x_
+				&& scanned.edge_.second.y_ == trimmed.edge_.second.y_))
+			throw std::runtime_error("Internal error: Kinetic trim differs");
+#endif
+		return trimmed;
+	}
+
+	/**
+	 * @return How often the events of a direction were collected.
+	 */
+	size_t collects() const {
+		return collects_;
+	}
+
+	/**
+	 * @return How often the events of a direction were reused.
+	 */
+	size_t reuses() const {
+		return reuses_;
+	}
+
+	/**
+	 * @return How many vertex/edge pairs were intersected.
+	 */
+	size_t tests() const {
+		return tests_;
+	}
+};
+}
+}
+
+#endif /* SRC_ALGO_KINETIC_TRIM_HPP_ */
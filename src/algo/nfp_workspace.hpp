@@ -0,0 +1,50 @@
+#ifndef SRC_ALGO_NFP_WORKSPACE_HPP_
+#define SRC_ALGO_NFP_WORKSPACE_HPP_
+
+#include <vector>
+
+#include "../geometry.hpp"
+#include "../translation_vector.hpp"
+#include "../history.hpp"
+#include "touching_point.hpp"
+#include "trim_cache.hpp"
+#include "find_feasible.hpp"
+#include "cycle_detector.hpp"
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+/**
+ * @brief All buffers a slide needs per step. They are cleared but never shrunk, so once they have grown to the size
+ * a pair of polygons needs, the steps of a slide don't allocate for them anymore.
+ * A workspace may be reused by any number of slides and %generate_nfp calls, but only by one at a time.
+ * Use %local for the workspace of the calling thread.
+ * %trimEngine_ selects how the slides trim their translation vectors, see %TrimEngine.
+ */
+struct NfpWorkspace {
+	std::vector<TouchingPoint> touchers_;
+	TouchingPointScratch touchingScratch_;
+	ContactTracker contacts_;
+	std::vector<TranslationVector> feasibleVectors_;
+	FeasibleScratch feasibleScratch_;
+	//scratch buffer of the selection for sorting by history count
+	std::vector<std::pair<size_t, TranslationVector>> counted_;
+	History history_;
+	TrimCache trimCache_;
+	TrimEngine trimEngine_ = TRIM_SCAN;
+	KineticEngine kinetic_;
+	CycleDetector cycles_;
+	//ring B at its current position, for the overlap check
+	polygon_t::ring_type translatedB_;
+
+	/**
+	 * @return The workspace of the calling thread.
+	 */
+	static NfpWorkspace& local() {
+		static thread_local NfpWorkspace workspace;
+		return workspace;
+	}
+};
+}
+}
+
+#endif /* SRC_ALGO_NFP_WORKSPACE_HPP_ */
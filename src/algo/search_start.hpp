@@ -3,8 +3,13 @@
 
 #include "../geometry.hpp"
 #include "../translation_vector.hpp"
+#include "../translated_ring.hpp"
+#include "../nfp_index.hpp"
+#include "../prepared_ring.hpp"
+#include "../thread_pool.hpp"
 
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
 
 /**
  * @brief Indicating the result of %search_start_translation
@@ -15,125 +20,209 @@ enum SearchStartResult {
 	NOT_FOUND//!< NOT_FOUND
 };
 
+/**
+ * @brief Check if a translated ring of B is a valid start position.
+ * The checks are ordered by cost, and the translated ring is only copied to scratch if none of the cheap checks rejects it.
+ * @param preparedA The prepared ring of polygon A.
+ * @param translated The translated ring of polygon B.
+ * @param boxB The bounding box of the translated ring.
+ * @param nfp The NFP so far.
+ * @param nfpIndex The %NfpIndex of the NFP. Has to be up to date.
+ * @param inside Look for start positions inside of rA.
+ * @param scratch A ring the translated ring is copied to, only if the cheap checks pass.
+ * @return true if B is either inside or outside of rA (as requested), doesn't overlap rA and its reference point isn't part of the NFP.
+ */
+bool is_start_position(const PreparedRing& preparedA, const TranslatedRing& translated, const boxf_t& boxB, const nfp_t& nfp, const NfpIndex& nfpIndex, const bool& inside, polygon_t::ring_type& scratch) {
+	bool bInside = false;
+	for (psize_t j = 0; j < translated.size(); ++j) {
+		int location = preparedA.locate(translated[j]);
+		if (location == 1) {
+			bInside = true;
+			break;
+		} else if (location == -1) {
+			bInside = false;
+			break;
+		}
+	}
+
+	if (bInside != inside)
+		return false;
+
+	if (nfpIndex.touches(translated.front(), nfp))
+		return false;
+
+	const polygon_t::ring_type& rA = preparedA.ring();
+	//a ring can only be covered by another one if its extents are
+	bool mayCoverB = box_within(boxB, preparedA.box());
+	bool mayCoverA = box_within(preparedA.box(), boxB);
+
+	translated.materialize(scratch);
+	return !bg::overlaps(scratch, rA) && !(mayCoverB && bg::covered_by(scratch, rA)) && !(mayCoverA && bg::covered_by(rA, scratch));
+}
+
+/**
+ * @brief Evaluate one candidate of the start search: vertex index of rA is placed on vertex ptB of rB.
+ * @param rA The ring of polygon A.
+ * @param preparedA The prepared rA.
+ * @param rB The ring of polygon B.
+ * @param localBoxB The bounding box of rB.
+ * @param index The index of the vertex of rA.
+ * @param ptB The vertex of rB.
+ * @param nfp The NFP so far.
+ * @param nfpIndex The %NfpIndex of the NFP. Has to be up to date.
+ * @param inside Look for start positions inside of rA.
+ * @param scratch A scratch ring.
+ * @param result The translation is written to if the result isn't NOT_FOUND.
+ * @return A %SearchStartResult for this candidate.
+ */
+SearchStartResult evaluate_start_candidate(const polygon_t::ring_type& rA, const PreparedRing& preparedA, const polygon_t::ring_type& rB, const boxf_t& localBoxB, const psize_t& index, const point_t& ptB, const nfp_t& nfp, const NfpIndex& nfpIndex, const bool& inside, polygon_t::ring_type& scratch, point_t& result) {
+	const point_t& ptA = rA[index];
+	point_t testTranslation = ptA - ptB;
+	TranslatedRing translated(rB, testTranslation);
+	boxf_t boxB = translate_box(localBoxB, testTranslation);
+
+	//check if translated rB is part of rA. that is only possible if the extents of rA lie within those of rB.
+	bool identical = false;
+	if (box_within(preparedA.box(), boxB)) {
+		for (const auto& ptA : rA) {
+			identical = false;
+			for (psize_t j = 0; j < translated.size(); ++j) {
+				if (equals(translated[j], ptA)) {
+					identical = true;
+					break;
+				}
+			}
+			if (!identical)
+				break;
+		}
+	}
+
+	if (identical) {
+		result = testTranslation;
+		return FIT;
+	}
+
+	if (is_start_position(preparedA, translated, boxB, nfp, nfpIndex, inside, scratch)) {
+		result = testTranslation;
+		return FOUND;
+	}
+
+	point_t nextPtA = rA[index + 1];
+	TranslationVector slideVector;
+	slideVector.vector_ = nextPtA - ptA;
+	slideVector.edge_ = {ptA, nextPtA};
+	slideVector.fromA_ = true;
+	TranslationVector trimmed = slideVector; //trim_vector(rA, translated, slideVector);
+	TranslatedRing translated2(rB, testTranslation + trimmed.vector_);
+
+	if (is_start_position(preparedA, translated2, translate_box(localBoxB, translated2.offset()), nfp, nfpIndex, inside, scratch)) {
+		result = trimmed.vector_ + testTranslation;
+		return FOUND;
+	}
+	return NOT_FOUND;
+}
+
 /**
  * @brief At the start of traversal and after every completed nfp-ring this function is used to search for a new start position.
  * @param rA The ring of polygon A to search for a new start position.
+ * @param preparedA The prepared rA.
+ * @param visitedA The visitation state of the vertices of rA. Visited vertices are skipped and every vertex tried is marked as visited.
  * @param rB The ring of polygon B to try to fit into a new start position.
  * @param nfp The NFP so far.
+ * @param nfpIndex The %NfpIndex of the NFP.
+ * @param inside Look for start positions inside of rA.
  * @param result The reference, the translation vector that would lead to a new start position, is written to.
+ * @param pool If not null the candidates are evaluated in parallel on this pool.
+ * The result (and the vertices that are marked as visited) are the same as those of the serial search.
  *
  * @return A %SearchStartResult that indicates if either a perfect fit, a new start position or new possible position was found
  */
-SearchStartResult search_start_translation(polygon_t::ring_type& rA, const polygon_t::ring_type& rB, const nfp_t& nfp, const bool& inside, point_t& result) {
-	for (psize_t i = 0; i < rA.size() - 1; i++) {
-		psize_t index;
-		if (i >= rA.size())
-			index = i % rA.size() + 1;
-		else
-			index = i;
-
-		auto& ptA = rA[index];
-
-		if (ptA.marked_)
-			continue;
-
-		ptA.marked_ = true;
-
-		for (const auto& ptB : rB) {
-			point_t testTranslation = ptA - ptB;
-			polygon_t::ring_type translated;
-			boost::geometry::transform(rB, translated, trans::translate_transformer<coord_t, 2, 2>(testTranslation.x_, testTranslation.y_));
-
-			//check if translated rB is part of rA
-			bool identical = false;
-			for (const auto& ptA : rA) {
-				identical = false;
-				for (const auto& ptT : translated) {
-					if (equals(ptT, ptA)) {
-						identical = true;
-						break;
-					} else if(identical) {
-						identical = false;
-						break;
-					}
-				}
-				if (!identical)
-					break;
-			}
-
-			if (identical) {
-				result = testTranslation;
-				return FIT;
+SearchStartResult search_start_translation(const polygon_t::ring_type& rA, const PreparedRing& preparedA, std::vector<bool>& visitedA, const polygon_t::ring_type& rB, const nfp_t& nfp, NfpIndex& nfpIndex, const bool& inside, point_t& result, ThreadPool* pool = nullptr) {
+	//the candidates only query the index, which makes them safe to evaluate in parallel
+	nfpIndex.update(nfp);
+	boxf_t localBoxB = make_box(TranslatedRing(rB));
+
+	if (pool == nullptr || pool->size() < 2) {
+		//scratch ring for the checks that need a translated copy of rB
+		polygon_t::ring_type scratch;
+
+		for (psize_t i = 0; i < rA.size() - 1; i++) {
+			psize_t index;
+			if (i >= rA.size())
+				index = i % rA.size() + 1;
+			else
+				index = i;
+
+			if (visitedA[index])
+				continue;
+
+			visitedA[index] = true;
+
+			for (const auto& ptB : rB) {
+				SearchStartResult res = evaluate_start_candidate(rA, preparedA, rB, localBoxB, index, ptB, nfp, nfpIndex, inside, scratch, result);
+				if (res != NOT_FOUND)
+					return res;
 			}
+		}
+		return NOT_FOUND;
+	}
 
-			bool bInside = false;
-			for (const auto& ptT : translated) {
-				if (bg::within(ptT, rA)) {
-					bInside = true;
-					break;
-				} else if (!bg::touches(ptT, rA)) {
-					bInside = false;
-					break;
-				}
-			}
+	//candidate k places vertex unvisited[k / rB.size()] of rA on vertex k % rB.size() of rB, which is the order of the serial search
+	std::vector<psize_t> unvisited;
+	for (psize_t i = 0; i < rA.size() - 1; i++) {
+		if (!visitedA[i])
+			unvisited.push_back(i);
+	}
 
-			if (((bInside && inside) || (!bInside && !inside)) && (!bg::overlaps(translated, rA) && !bg::covered_by(translated, rA) && !bg::covered_by(rA, translated)) && !in_nfp(translated.front(), nfp)) {
-				result = testTranslation;
-				return FOUND;
+	const size_t BLOCK_SIZE = 16;
+	size_t numCandidates = unvisited.size() * rB.size();
+	size_t numBlocks = (numCandidates + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::atomic<size_t> first(numCandidates);
+	std::vector<SearchStartResult> results(numCandidates, NOT_FOUND);
+	std::vector<point_t> translations(numCandidates);
+	//an exception ends the serial search just like a hit does, so it is only rethrown if there is no earlier hit
+	std::vector<std::exception_ptr> errors(numCandidates);
+
+	pool->parallel_for(numBlocks, [&](const size_t& block) {
+		polygon_t::ring_type scratch;
+		size_t end = std::min(numCandidates, (block + 1) * BLOCK_SIZE);
+		for (size_t k = block * BLOCK_SIZE; k < end; ++k) {
+			//a hit earlier in order was already found
+			if (first.load() < k)
+				return;
+
+			try {
+				results[k] = evaluate_start_candidate(rA, preparedA, rB, localBoxB, unvisited[k / rB.size()], rB[k % rB.size()], nfp, nfpIndex, inside, scratch, translations[k]);
+			} catch (...) {
+				errors[k] = std::current_exception();
 			}
 
-			point_t nextPtA = rA[index + 1];
-			TranslationVector slideVector;
-			slideVector.vector_ = nextPtA - ptA;
-			slideVector.edge_ = {ptA, nextPtA};
-			slideVector.fromA_ = true;
-			TranslationVector trimmed = slideVector; //trim_vector(rA, translated, slideVector);
-			polygon_t::ring_type translated2;
-			trans::translate_transformer<coord_t, 2, 2> trans(trimmed.vector_.x_, trimmed.vector_.y_);
-			boost::geometry::transform(translated, translated2, trans);
-
-			//check if translated rB is part of rA
-			identical = false;
-			for (const auto& ptA : rA) {
-				identical = false;
-				for (const auto& ptT : translated) {
-					if (equals(ptT, ptA)) {
-						identical = true;
-						break;
-					} else if(identical) {
-						identical = false;
-						break;
-					}
-				}
-				if (!identical)
-					break;
+			if (results[k] != NOT_FOUND || errors[k]) {
+				size_t current = first.load();
+				while (k < current && !first.compare_exchange_weak(current, k))
+					;
+				return;
 			}
+		}
+	});
 
-			if (identical) {
-				result = trimmed.vector_ + testTranslation;
-				return FIT;
-			}
+	//mark the vertices the serial search would have visited
+	size_t visited = first < numCandidates ? first / rB.size() + 1 : unvisited.size();
+	for (size_t i = 0; i < visited; ++i) {
+		visitedA[unvisited[i]] = true;
+	}
 
-			bInside = false;
-			for (const auto& ptT : translated2) {
-				if (bg::within(ptT, rA)) {
-					bInside = true;
-					break;
-				} else if (!bg::touches(ptT, rA)) {
-					bInside = false;
-					break;
-				}
-			}
+	if (first < numCandidates) {
+		if (errors[first])
+			std::rethrow_exception(errors[first]);
 
-			if (((bInside && inside) || (!bInside && !inside)) && (!bg::overlaps(translated2, rA) && !bg::covered_by(translated2, rA) && !bg::covered_by(rA, translated2)) && !in_nfp(translated2.front(), nfp)) {
-				result = trimmed.vector_ + testTranslation;
-				return FOUND;
-			}
-		}
+		result = translations[first];
+		return results[first];
 	}
 	return NOT_FOUND;
 }
 }
+}
 
 
 
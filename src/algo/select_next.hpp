@@ -4,8 +4,13 @@
 #include "../geometry.hpp"
 #include "../translation_vector.hpp"
 #include "../history.hpp"
+#include "../edge_index.hpp"
+#include "../soa_ring.hpp"
+#include "../nfp_index.hpp"
+#include "trim_cache.hpp"
 
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
 /**
  * @brief Find the longest translation vector.
  * @param tvs The translation vectors.
@@ -43,26 +48,52 @@ void sort_by_length(std::vector<TranslationVector>& tvs) {
  * @brief Sort a std::vector of translation vectors by history count.
  * @param history The history of used translation vectors.
  * @param tvs The std::vector to sort.
+ * @param counted Scratch buffer for the counted vectors. Its content is overwritten.
  */
-void sort_by_history_count(const History& history, std::vector<TranslationVector>& tvs) {
-	std::sort( tvs.begin( ), tvs.end( ), [&]( const TranslationVector& lhs, const TranslationVector& rhs ) {
-		size_t cl = count(history, lhs);
-		size_t cr = count(history, rhs);
-		return cl < cr;
+void sort_by_history_count(const History& history, std::vector<TranslationVector>& tvs, std::vector<std::pair<size_t, TranslationVector>>& counted) {
+	//count every vector once instead of in every comparison
+	counted.clear();
+	for (auto& tv : tvs) {
+		counted.push_back( { count(history, tv), std::move(tv) });
+	}
+
+	std::sort( counted.begin( ), counted.end( ), [&]( const std::pair<size_t, TranslationVector>& lhs, const std::pair<size_t, TranslationVector>& rhs ) {
+		return lhs.first < rhs.first;
 	});
+
+	for (size_t i = 0; i < tvs.size(); ++i) {
+		tvs[i] = std::move(counted[i].second);
+	}
+}
+
+/**
+ * @brief Sort a std::vector of translation vectors by history count.
+ * @param history The history of used translation vectors.
+ * @param tvs The std::vector to sort.
+ */
+void sort_by_history_count(const History& history, std::vector<TranslationVector>& tvs) {
+	std::vector<std::pair<size_t, TranslationVector>> counted;
+	counted.reserve(tvs.size());
+	sort_by_history_count(history, tvs, counted);
 }
 
 /**
  * @brief Select the next translation vector from all viable translations.
  * @param nfp The NFP so far.
+ * @param nfpIndex The %NfpIndex of the NFP.
  * @param pA Polygon A.
  * @param rA The pertaining ring of polygon A.
- * @param rB Ring of B.
- * @param feasibleVectors All viable translations (= all translations that lead to a valid slide, including already traversed ones)
+ * @param indexA The %EdgeIndex of rA.
+ * @param rB Ring of B in local coordinates.
+ * @param offsetB The current translation of rB.
+ * @param indexB The %EdgeIndex of rB in local coordinates.
+ * @param feasibleVectors All viable translations (= all translations that lead to a valid slide, including already traversed ones). They are reordered.
  * @param history The history of all performed translations
+ * @param trimCache The %TrimCache of the current step.
+ * @param counted Scratch buffer for sorting by history count. Its content is overwritten.
  * @return The translation vector used for the next traversal step (slide)
  */
-TranslationVector select_next_translation_vector(const nfp_t& nfp, const polygon_t& pA, const polygon_t::ring_type& rA, const polygon_t::ring_type& rB, std::vector<TranslationVector> feasibleVectors, const History& history) {
+TranslationVector select_next_translation_vector(const nfp_t& nfp, NfpIndex& nfpIndex, const polygon_t& pA, const SoaRing& rA, const EdgeIndex& indexA, const SoaRing& rB, const point_t& offsetB, const EdgeIndex& indexB, std::vector<TranslationVector>& feasibleVectors, const History& history, TrimCache& trimCache, std::vector<std::pair<size_t, TranslationVector>>& counted) {
 	if(feasibleVectors.size() == 1) {
 		return feasibleVectors.front();
 	}
@@ -82,13 +113,15 @@ TranslationVector select_next_translation_vector(const nfp_t& nfp, const polygon
 		size_t minHistCnt = history.size() + 1;
 		TranslationVector least_used;
 
-		sort_by_history_count(history, feasibleVectors);
+		sort_by_history_count(history, feasibleVectors, counted);
 
+		point_t front;
+		rB.translated(0, offsetB, front);
 		for(auto& candidate : feasibleVectors) {
 			point_t translated;
-			TranslationVector trimmed = trim_vector(rA, rB, candidate);
-			boost::geometry::transform(rB.front(), translated, trans::translate_transformer<coord_t, 2, 2>(trimmed.vector_.x_, trimmed.vector_.y_));
-			if(!in_nfp(translated, nfp)) {
+			TranslationVector trimmed = trimCache.trim(rA, indexA, rB, offsetB, indexB, candidate);
+			boost::geometry::transform(front, translated, trans::translate_transformer<coord_t, 2, 2>(trimmed.vector_.x_, trimmed.vector_.y_));
+			if(!in_nfp(translated, nfp, nfpIndex)) {
 				DEBUG_MSG("least unused, not in nfp", candidate);
 				return candidate;
 			}
@@ -125,6 +158,7 @@ TranslationVector select_next_translation_vector(const nfp_t& nfp, const polygon
 	}
 }
 }
+}
 
 
 #endif /* SRC_ALGO_SELECT_NEXT_HPP_ */
@@ -3,8 +3,15 @@
 
 #include "../geometry.hpp"
 #include "../translation_vector.hpp"
+#include "../edge_index.hpp"
+#include "../translated_ring.hpp"
+#include "../soa_ring.hpp"
+#include "../nfp_index.hpp"
+#include "../prepared_ring.hpp"
+#include "nfp_workspace.hpp"
 
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
 
 /**
  * Indicates the result of the slide function
@@ -18,30 +25,50 @@ enum SlideResult {
 /**
  * The function actually performs the orbiting by sliding one ring around the other.
  * @param pA Polygon A
- * @param rA Ring of A
+ * @param preparedA The prepared ring of A. Its %EdgeIndex is used for the touching points and for trimming.
+ * @param visitedA The visitation state of the vertices of the ring of A. Every vertex B touches is marked as visited.
  * @param rB Ring of B
  * @param nfp The NFP reference to write the traversal to.
+ * @param nfpIndex The %NfpIndex of the NFP. Updated with every point appended to the NFP.
  * @param startTrans The initial translation to perform on rB.
  * @param inside We are sliding on the inside, which means we previously determined that we are in a hole.
+ * @param workspace The buffers of the steps. Apart from appending to the NFP the steps only allocate until they have grown large enough.
  * @throws runtime_error on internal errors
  * @return A SlideResult, which indicates:
  * we were able to successfully create a NFP-loop (LOOP) or,
- * we were not because we ran out of feasible translations (NO_LOOP) or
+ * we were not because we ran out of feasible translations (NO_LOOP), which includes a cycle (see %CycleDetector) without another feasible translation, or
  * we were unable to find a valid next position (NO_TRANSLATION)
  */
-SlideResult slide(polygon_t& pA, polygon_t::ring_type& rA, polygon_t::ring_type& rB, nfp_t& nfp, const point_t& startTrans, bool inside) {
-	polygon_t::ring_type rifsB;
-	boost::geometry::transform(rB, rifsB, trans::translate_transformer<coord_t, 2, 2>(startTrans.x_, startTrans.y_));
-	rB = std::move(rifsB);
+SlideResult slide(const polygon_t& pA, const PreparedRing& preparedA, std::vector<bool>& visitedA, polygon_t::ring_type& rB, nfp_t& nfp, NfpIndex& nfpIndex, const point_t& startTrans, bool inside, NfpWorkspace& workspace) {
+	//rB stays in local coordinates, only the offset of the view is updated
+	TranslatedRing tB(rB, startTrans);
+	//scratch ring for the overlap check
+	polygon_t::ring_type& translatedB = workspace.translatedB_;
 
 #ifdef NFP_DEBUG
-	write_svg("ifs.svg", pA, rB);
+	tB.materialize(translatedB);
+	write_svg("ifs.svg", pA, translatedB);
 #endif
 
 	bool startAvailable = true;
 	psize_t cnt = 0;
-	point_t referenceStart = rB.front();
-	History history;
+	point_t referenceStart = tB.front();
+	History& history = workspace.history_;
+	history.clear();
+	const SoaRing& rA = preparedA.soa();
+	const EdgeIndex& indexA = preparedA.index();
+	SoaRing soaB(rB);
+	EdgeIndex indexB(rB);
+	TrimCache& trimCache = workspace.trimCache_;
+	trimCache.clear();
+	KineticEngine& kinetic = workspace.kinetic_;
+	kinetic.reset();
+	trimCache.use(workspace.trimEngine_ == TRIM_EVENTS ? &kinetic : nullptr);
+	ContactTracker& contacts = workspace.contacts_;
+	contacts.reset();
+	std::vector<TouchingPoint>& touchers = workspace.touchers_;
+	std::vector<TranslationVector>& feasibleVectors = workspace.feasibleVectors_;
+	SlideResult result = LOOP;
 
 	//generate the nfp for the ring
 	while (startAvailable) {
@@ -50,18 +77,19 @@ SlideResult slide(polygon_t& pA, polygon_t::ring_type& rA, polygon_t::ring_type&
 		DEBUG_VAL("#### iteration: " + std::to_string(cnt) + " ####");
 
 		//use first point of rB as reference
-		nfp.back().push_back(rB.front());
+		nfp.back().push_back(tB.front());
+		nfpIndex.update(nfp);
 		if (cnt == 15)
 			std::cerr << "";
 
-		std::vector<TouchingPoint> touchers = find_touching_points(rA, rB);
+		contacts.find(rA, indexA, soaB, tB.offset(), touchers, workspace.touchingScratch_);
 
 		DEBUG_MSG("touchers", touchers.size());
 
 		if (touchers.empty()) {
 			throw std::runtime_error("Internal error: No touching points found");
 		}
-		std::vector<TranslationVector> feasibleVectors = find_feasible_translation_vectors(rA, rB, touchers);
+		find_feasible_translation_vectors(rA, indexA, visitedA, soaB, tB.offset(), indexB, touchers, trimCache, feasibleVectors, workspace.feasibleScratch_);
 
 
 #ifdef NFP_DEBUG
@@ -72,36 +100,67 @@ SlideResult slide(polygon_t& pA, polygon_t::ring_type& rA, polygon_t::ring_type&
 #endif
 
 		if (feasibleVectors.empty()) {
-			return NO_LOOP;
+			result = NO_LOOP;
+			break;
 		}
 
-		TranslationVector next = select_next_translation_vector(nfp, pA, rA, rB, feasibleVectors, history);
+		TranslationVector next = select_next_translation_vector(nfp, nfpIndex, pA, rA, indexA, soaB, tB.offset(), indexB, feasibleVectors, history, trimCache, workspace.counted_);
 
-		if (equals(next.vector_, INVALID_POINT))
-			return NO_TRANSLATION;
+		if (equals(next.vector_, INVALID_POINT)) {
+			result = NO_TRANSLATION;
+			break;
+		}
+
+		if (workspace.cycles_.detect(history, nfp.back(), next) > 0) {
+			//the slide walked the same lap twice and would start it again, take another feasible translation instead
+			auto other = std::find_if(feasibleVectors.begin(), feasibleVectors.end(), [&](const TranslationVector& tv) {
+				return tv != next;
+			});
+			DEBUG_MSG("cycle detected", next);
+			if (other == feasibleVectors.end()) {
+				result = NO_LOOP;
+				break;
+			}
+			next = *other;
+		}
 
-		TranslationVector trimmed = trim_vector(rA, rB, next);
+		TranslationVector trimmed = trimCache.trim(rA, indexA, soaB, tB.offset(), indexB, next);
 		DEBUG_MSG("trimmed", trimmed);
 
 		DEBUG_MSG("next", next);
 		history.push_back(next);
 
-		polygon_t::ring_type nextRB;
-		boost::geometry::transform(rB, nextRB, trans::translate_transformer<coord_t, 2, 2>(trimmed.vector_.x_, trimmed.vector_.y_));
-		rB = std::move(nextRB);
+		tB.translate(trimmed.vector_);
+		trimCache.clear();
+		kinetic.advance(trimmed.vector_);
+		tB.materialize(translatedB);
 
 #ifdef NFP_DEBUG
-		write_svg("next" + std::to_string(cnt) + ".svg", pA,rB);
+		write_svg("next" + std::to_string(cnt) + ".svg", pA, translatedB);
 #endif
-		if(bg::overlaps(pA, rB))
+		if(bg::overlaps(pA, translatedB))
 			throw std::runtime_error("Internal error: Slide resulted in overlap");
 
 		++cnt;
-		if (equals(referenceStart, rB.front()) || (inside && bg::touches(rB.front(), nfp.front()))) {
+		if (equals(referenceStart, tB.front()) || (inside && nfpIndex.touches(tB.front(), nfp, 0))) {
 			startAvailable = false;
 		}
 	}
-	return LOOP;
+
+	DEBUG_MSG("trim cache hits", trimCache.hits());
+	DEBUG_MSG("trim cache misses", trimCache.misses());
+	DEBUG_MSG("contact collects", contacts.collects());
+	DEBUG_MSG("contact updates", contacts.updates());
+	DEBUG_MSG("kinetic collects", kinetic.collects());
+	DEBUG_MSG("kinetic reuses", kinetic.reuses());
+	DEBUG_MSG("cycles", workspace.cycles_.cycles());
+	DEBUG_MSG("cycle steps saved", workspace.cycles_.saved());
+
+	//leave rB at the position the slide ended
+	tB.materialize(translatedB);
+	rB = translatedB;
+	return result;
+}
 }
 }
 
@@ -3,8 +3,13 @@
 #define SRC_ALGO_TOUCHING_POINT_HPP_
 
 #include "../geometry.hpp"
+#include "../edge_index.hpp"
+#include "../translated_ring.hpp"
+#include "../soa_ring.hpp"
+#include "../simd.hpp"
 
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
 /**
  * Stores information about a touching point
  */
@@ -32,31 +37,277 @@ struct TouchingPoint {
 };
 
 /**
- * @brief Search for touching points of two rings of A and B
+ * @brief The scratch buffers of %find_touching_points. Reusing them across calls avoids allocating them in every slide step.
+ */
+struct TouchingPointScratch {
+	//the pairs of edges whose bounding boxes intersect
+	std::vector<std::pair<psize_t, psize_t>> candidates_;
+	std::vector<EdgeIndex::value_t> edges_;
+};
+
+/**
+ * @brief Test pairs of edges of two rings of A and B for touching points.
  * @param ringA Ring of A
- * @param ringB Ring of B
- * @return A %vector of %TouchingPoint objects
+ * @param ringB Ring of B in local coordinates
+ * @param offsetB The current translation of ringB
+ * @param candidates The pairs of an edge of A and an edge of B to test, in the order the touching points are reported.
+ * @param touchers Receives the %TouchingPoint objects. Appended to.
  */
-std::vector<TouchingPoint> find_touching_points(const polygon_t::ring_type& ringA, const polygon_t::ring_type& ringB) {
-	std::vector<TouchingPoint> touchers;
-	for (psize_t i = 0; i < ringA.size() - 1; i++) {
+void test_touching_candidates(const SoaRing& ringA, const SoaRing& ringB, const point_t& offsetB, const std::vector<std::pair<psize_t, psize_t>>& candidates, std::vector<TouchingPoint>& touchers) {
+	//the points are written to these, which reuses their storage
+	point_t ptA;
+	point_t nextA;
+	point_t ptB;
+	point_t nextB;
+	auto test = [&](const psize_t& i, const psize_t& j) {
 		psize_t nextI = i + 1;
-		for (psize_t j = 0; j < ringB.size() - 1; j++) {
-			psize_t nextJ = j + 1;
-			if (equals(ringA[i], ringB[j])) {
-				DEBUG_MSG("vertex", segment_t(ringA[i],ringB[j]));
-				touchers.push_back( { TouchingPoint::VERTEX, i, j });
-			} else if (!equals(ringA[nextI], ringB[j]) && bg::intersects(segment_t(ringA[i], ringA[nextI]), ringB[j])) {
-				DEBUG_MSG("bona", segment_t(ringA[i],ringB[j]));
-				touchers.push_back( { TouchingPoint::B_ON_A, nextI, j });
-			} else if (!equals(ringB[nextJ], ringA[i]) && bg::intersects(segment_t(ringB[j], ringB[nextJ]), ringA[i])) {
-				DEBUG_MSG("aonb", segment_t(ringA[i],ringB[j]));
+		psize_t nextJ = j + 1;
+		ringA.get(i, ptA);
+		ringB.translated(j, offsetB, ptB);
+		if (equals(ptA, ptB)) {
+			DEBUG_MSG("vertex", segment_t(ptA, ptB));
+			touchers.push_back( { TouchingPoint::VERTEX, i, j });
+			return;
+		}
+
+		ringA.get_next(i, nextA);
+		if (!equals(nextA, ptB) && on_segment(ptA, nextA, ptB)) {
+			DEBUG_MSG("bona", segment_t(ptA, ptB));
+			touchers.push_back( { TouchingPoint::B_ON_A, nextI, j });
+		} else {
+			ringB.translated(nextJ, offsetB, nextB);
+			if (!equals(nextB, ptA) && on_segment(ptB, nextB, ptA)) {
+				DEBUG_MSG("aonb", segment_t(ptA, ptB));
 				touchers.push_back( { TouchingPoint::A_ON_B, i, nextJ });
 			}
 		}
+	};
+
+#ifdef LIBNFP_USE_DOUBLE
+	//most candidates are rejected by the vectorized filter, the others are tested in the same order as without it
+	if (simd_level() != SIMD_SCALAR) {
+		const coord_t* xA = ringA.xs();
+		const coord_t* yA = ringA.ys();
+		const coord_t* xB = ringB.xs();
+		const coord_t* yB = ringB.ys();
+		const double offX = offsetB.x_.val();
+		const double offY = offsetB.y_.val();
+		TouchLanes lanes = TouchLanes();
+		for (size_t first = 0; first < candidates.size(); first += SIMD_BATCH) {
+			size_t n = std::min(SIMD_BATCH, candidates.size() - first);
+			for (size_t k = 0; k < n; ++k) {
+				const psize_t& i = candidates[first + k].first;
+				const psize_t& j = candidates[first + k].second;
+				lanes.ax_[k] = xA[i].val();
+				lanes.ay_[k] = yA[i].val();
+				lanes.anx_[k] = xA[i + 1].val();
+				lanes.any_[k] = yA[i + 1].val();
+				lanes.bx_[k] = xB[j].val() + offX;
+				lanes.by_[k] = yB[j].val() + offY;
+				lanes.bnx_[k] = xB[j + 1].val() + offX;
+				lanes.bny_[k] = yB[j + 1].val() + offY;
+			}
+
+			uint32_t mask = touch_mask(lanes, n);
+			for (size_t k = 0; k < n; ++k) {
+				if (mask & (uint32_t(1) << k))
+					test(candidates[first + k].first, candidates[first + k].second);
+			}
+		}
+		return;
+	}
+#endif
+
+	for (const auto& c : candidates) {
+		test(c.first, c.second);
+	}
+}
+
+/**
+ * @brief Search for touching points of two rings of A and B
+ * Only pairs of edges whose bounding boxes intersect are tested. The candidates are tested in the same order as a full scan would, so the result is identical.
+ * @param ringA Ring of A
+ * @param indexA The %EdgeIndex of ringA
+ * @param ringB Ring of B in local coordinates
+ * @param offsetB The current translation of ringB
+ * @param touchers Receives the %TouchingPoint objects. Cleared first.
+ * @param scratch The scratch buffers. Their content is overwritten.
+ */
+void find_touching_points(const SoaRing& ringA, const EdgeIndex& indexA, const SoaRing& ringB, const point_t& offsetB, std::vector<TouchingPoint>& touchers, TouchingPointScratch& scratch) {
+	std::vector<std::pair<psize_t, psize_t>>& candidates = scratch.candidates_;
+	std::vector<EdgeIndex::value_t>& edgesA = scratch.edges_;
+	touchers.clear();
+	candidates.clear();
+	//the translated points of B are written to these, which reuses their storage
+	point_t ptB;
+	point_t nextB;
+
+	ringB.translated(0, offsetB, nextB);
+	for (psize_t j = 0; j < ringB.size() - 1; j++) {
+		std::swap(ptB, nextB);
+		ringB.translated(j + 1, offsetB, nextB);
+		edgesA.clear();
+		indexA.query(make_box(ptB, nextB), std::back_inserter(edgesA));
+		for (const auto& e : edgesA) {
+			candidates.push_back( { e.second, j });
+		}
 	}
+	std::sort(candidates.begin(), candidates.end());
+	test_touching_candidates(ringA, ringB, offsetB, candidates, touchers);
+}
+
+/**
+ * @brief Search for touching points of two rings of A and B
+ * @param ringA Ring of A
+ * @param indexA The %EdgeIndex of ringA
+ * @param ringB Ring of B in local coordinates
+ * @param offsetB The current translation of ringB
+ * @return A %vector of %TouchingPoint objects
+ */
+std::vector<TouchingPoint> find_touching_points(const SoaRing& ringA, const EdgeIndex& indexA, const SoaRing& ringB, const point_t& offsetB) {
+	std::vector<TouchingPoint> touchers;
+	TouchingPointScratch scratch;
+	find_touching_points(ringA, indexA, ringB, offsetB, touchers, scratch);
 	return touchers;
 }
+
+/**
+ * @brief Keeps track of the touching points of B while it slides around A.
+ * Instead of querying the %EdgeIndex of A with every edge of B in every step, the pairs of edges that are close to each other are collected once
+ * with boxes grown by a skin distance, like a Verlet neighbour list. As long as B moved less than half the skin since, every pair whose boxes intersect
+ * is among them, so a step only filters the near pairs with the exact boxes and tests those. The near pairs are collected again when B moved further
+ * or when the slide starts. The result is always identical to %find_touching_points.
+ */
+class ContactTracker {
+	//the pairs of an edge of A and an edge of B whose grown boxes intersected at the anchor, sorted
+	std::vector<std::pair<psize_t, psize_t>> near_;
+	//the translation of B the near pairs were collected at
+	long double anchorX_ = 0;
+	long double anchorY_ = 0;
+	long double skin_ = 0;
+	bool valid_ = false;
+	size_t collects_ = 0;
+	size_t updates_ = 0;
+
+	/**
+	 * @brief Collect the near pairs at the current translation of ringB.
+	 */
+	void collect(const SoaRing& ringA, const EdgeIndex& indexA, const SoaRing& ringB, const point_t& offsetB, TouchingPointScratch& scratch) {
+		std::vector<EdgeIndex::value_t>& edgesA = scratch.edges_;
+		near_.clear();
+
+		//the skin is the mean extent of the edges of B, but at least the margin of the boxes of B, which covers the rounding of the translated points
+		long double extent = 0;
+		long double magnitude = 1;
+		for (psize_t j = 0; j + 1 < ringB.size(); ++j) {
+			const long double x = toLongDouble(ringB.xs()[j]);
+			const long double y = toLongDouble(ringB.ys()[j]);
+			extent += std::max(std::fabs(toLongDouble(ringB.xs()[j + 1]) - x), std::fabs(toLongDouble(ringB.ys()[j + 1]) - y));
+			magnitude = std::max({ magnitude, std::fabs(x + toLongDouble(offsetB.x_)), std::fabs(y + toLongDouble(offsetB.y_)) });
+		}
+		skin_ = std::max(extent / (ringB.size() - 1), 16 * NFP_EPSILON * magnitude);
+
+		point_t ptB;
+		point_t nextB;
+		ringB.translated(0, offsetB, nextB);
+		for (psize_t j = 0; j + 1 < ringB.size(); ++j) {
+			std::swap(ptB, nextB);
+			ringB.translated(j + 1, offsetB, nextB);
+			boxf_t box = make_box(ptB, nextB);
+			box.min_corner().x(box.min_corner().x() - skin_);
+			box.min_corner().y(box.min_corner().y() - skin_);
+			box.max_corner().x(box.max_corner().x() + skin_);
+			box.max_corner().y(box.max_corner().y() + skin_);
+			edgesA.clear();
+			indexA.query(box, std::back_inserter(edgesA));
+			for (const auto& e : edgesA) {
+				near_.push_back( { e.second, j });
+			}
+		}
+		std::sort(near_.begin(), near_.end());
+
+		anchorX_ = toLongDouble(offsetB.x_);
+		anchorY_ = toLongDouble(offsetB.y_);
+		valid_ = true;
+		++collects_;
+	}
+public:
+	/**
+	 * @brief Forget the near pairs. Has to be called whenever one of the rings changes, e.g. when a new slide starts.
+	 */
+	void reset() {
+		near_.clear();
+		valid_ = false;
+	}
+
+	/**
+	 * @brief Search for the touching points of ringB at its current translation.
+	 * @param ringA Ring of A
+	 * @param indexA The %EdgeIndex of ringA
+	 * @param ringB Ring of B in local coordinates
+	 * @param offsetB The current translation of ringB
+	 * @param touchers Receives the %TouchingPoint objects. Cleared first.
+	 * @param scratch The scratch buffers. Their content is overwritten.
+	 */
+	void find(const SoaRing& ringA, const EdgeIndex& indexA, const SoaRing& ringB, const point_t& offsetB, std::vector<TouchingPoint>& touchers, TouchingPointScratch& scratch) {
+		if (!valid_ || std::fabs(toLongDouble(offsetB.x_) - anchorX_) > skin_ / 2 || std::fabs(toLongDouble(offsetB.y_) - anchorY_) > skin_ / 2)
+			collect(ringA, indexA, ringB, offsetB, scratch);
+		else
+			++updates_;
+
+		std::vector<std::pair<psize_t, psize_t>>& candidates = scratch.candidates_;
+		touchers.clear();
+		candidates.clear();
+		point_t ptA;
+		point_t nextA;
+		point_t ptB;
+		point_t nextB;
+		for (const auto& n : near_) {
+			ringA.get(n.first, ptA);
+			ringA.get_next(n.first, nextA);
+			ringB.translated(n.second, offsetB, ptB);
+			ringB.translated_next(n.second, offsetB, nextB);
+			if (bg::intersects(make_box(ptA, nextA), make_box(ptB, nextB)))
+				candidates.push_back(n);
+		}
+		test_touching_candidates(ringA, ringB, offsetB, candidates, touchers);
+
+#ifdef NFP_DEBUG
+		std::vector<TouchingPoint> full = find_touching_points(ringA, indexA, ringB, offsetB);
+		bool same = full.size() == touchers.size();
+		for (size_t i = 0; same && i < full.size(); ++i) {
+			same = full[i].type_ == touchers[i].type_ && full[i].A_ == touchers[i].A_ && full[i].B_ == touchers[i].B_;
+		}
+		if (!same)
+			throw std::runtime_error("Internal error: Tracked touching points differ");
+#endif
+	}
+
+	/**
+	 * @return How often the near pairs were collected.
+	 */
+	size_t collects() const {
+		return collects_;
+	}
+
+	/**
+	 * @return How often the near pairs were reused.
+	 */
+	size_t updates() const {
+		return updates_;
+	}
+};
+
+/**
+ * @brief Search for touching points of two rings of A and B
+ * @param ringA Ring of A
+ * @param ringB Ring of B
+ * @return A %vector of %TouchingPoint objects
+ */
+std::vector<TouchingPoint> find_touching_points(const polygon_t::ring_type& ringA, const polygon_t::ring_type& ringB) {
+	return find_touching_points(SoaRing(ringA), EdgeIndex(ringA), SoaRing(ringB), point_t(0, 0));
+}
+}
 }
 
 
@@ -0,0 +1,94 @@
+#ifndef SRC_ALGO_TRIM_CACHE_HPP_
+#define SRC_ALGO_TRIM_CACHE_HPP_
+
+#include <vector>
+
+#include "../geometry.hpp"
+#include "../translation_vector.hpp"
+#include "../edge_index.hpp"
+#include "../soa_ring.hpp"
+#include "trim_vector.hpp"
+#include "kinetic_trim.hpp"
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+/**
+ * @brief Memoizes the results of %trim_vector during one step of the slide, as the same candidates are trimmed
+ * by the feasibility filter, the selection and the slide itself. Has to be cleared whenever one of the rings moves.
+ * The key is the exact (not epsilon compared) vector and edge of the translation, as those are the only inputs of the trim.
+ * Misses are trimmed by %trim_vector, or by a %KineticEngine if one is used.
+ */
+class TrimCache {
+	struct entry_t {
+		point_t vector_;
+		segment_t edge_;
+		point_t trimmedVector_;
+		segment_t trimmedEdge_;
+	};
+
+	std::vector<entry_t> entries_;
+	size_t hits_ = 0;
+	size_t misses_ = 0;
+	KineticEngine* engine_ = nullptr;
+
+	static bool identical(const point_t& lhs, const point_t& rhs) {
+		return lhs.x_ == rhs.x_ && lhs.y_ == rhs.y_;
+	}
+public:
+	/**
+	 * @brief Trim a given translation vector or return the memoized result.
+	 * @param rA Ring of A.
+	 * @param indexA The %EdgeIndex of rA.
+	 * @param rB Ring of B in local coordinates.
+	 * @param offsetB The current translation of rB.
+	 * @param indexB The %EdgeIndex of rB in local coordinates.
+	 * @param tv The given translation vector
+	 * @return The trimmed translation vector
+	 */
+	TranslationVector trim(const SoaRing& rA, const EdgeIndex& indexA, const SoaRing& rB, const point_t& offsetB, const EdgeIndex& indexB, const TranslationVector& tv) {
+		TranslationVector trimmed = tv;
+		for (const auto& e : entries_) {
+			if (identical(e.vector_, tv.vector_) && identical(e.edge_.first, tv.edge_.first) && identical(e.edge_.second, tv.edge_.second)) {
+				++hits_;
+				trimmed.vector_ = e.trimmedVector_;
+				trimmed.edge_ = e.trimmedEdge_;
+				return trimmed;
+			}
+		}
+
+		++misses_;
+		if (engine_ != nullptr)
+			trimmed = engine_->trim(rA, indexA, rB, offsetB, indexB, tv);
+		else
+			trimmed = trim_vector(rA, indexA, rB, offsetB, indexB, tv);
+		entries_.push_back( { tv.vector_, tv.edge_, trimmed.vector_, trimmed.edge_ });
+		return trimmed;
+	}
+
+	/**
+	 * @brief Trim the misses with the given engine instead of %trim_vector.
+	 * @param engine The engine, or nullptr for %trim_vector. Has to outlive its use by the cache.
+	 */
+	void use(KineticEngine* engine) {
+		engine_ = engine;
+	}
+
+	/**
+	 * @brief Forget all memoized results. The hit and miss counters are kept.
+	 */
+	void clear() {
+		entries_.clear();
+	}
+
+	size_t hits() const {
+		return hits_;
+	}
+
+	size_t misses() const {
+		return misses_;
+	}
+};
+}
+}
+
+#endif /* SRC_ALGO_TRIM_CACHE_HPP_ */
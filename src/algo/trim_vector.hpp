@@ -3,89 +3,478 @@
 
 #include "../geometry.hpp"
 #include "../translation_vector.hpp"
+#include "../edge_index.hpp"
+#include "../translated_ring.hpp"
+#include "../soa_ring.hpp"
+#include "../simd.hpp"
 
 namespace libnfporb {
-//TODO deduplicate code
+inline namespace LIBNFP_BACKEND {
+/**
+ * @brief Snap a segment parameter to the segment ends if it lies within epsilon of them.
+ * @param param The parameter to snap.
+ * @return false if the parameter lies outside of [0, 1].
+ */
+bool snap_parameter(coord_t& param) {
+	if (param < NFP_EPSILON) {
+		if (param < -NFP_EPSILON)
+			return false;
+		param = 0;
+	} else if (param > 1 - NFP_EPSILON) {
+		if (param > 1 + NFP_EPSILON)
+			return false;
+		param = 1;
+	}
+	return true;
+}
+
+#ifdef LIBNFP_USE_GRID
+/**
+ * @brief Intersect the translation of a point with a segment, all on the grid. Same as %intersect_translation,
+ * but the parameters of the intersection are exact rationals of 128 bit integers, so there is no epsilon.
+ * Only the intersection point itself is rounded, unless it is one of the given points.
+ */
+size_t intersect_translation_grid(const point_t& pt, const point_t& dir, const point_t& q1, const point_t& q2, point_t hits[2]) {
+	const point_t origin;
+	point_t e = q2 - q1;
+	point_t w = q1 - pt;
+	int128_t denom = grid_cross(origin, dir, e);
+
+	if (denom == 0) {
+		int128_t dd = grid_dot(dir, dir);
+		if (dd == 0 || grid_cross(origin, w, dir) != 0)
+			return 0;
+
+		//collinear: the hits are the ends of the overlapping part, t1 and t2 are the parameters scaled by dd
+		point_t end = pt + dir;
+		int128_t t1 = grid_dot(w, dir);
+		int128_t t2 = grid_dot(q2 - pt, dir);
+		const point_t* lo = &q1;
+		const point_t* hi = &q2;
+		if (t2 < t1) {
+			std::swap(t1, t2);
+			std::swap(lo, hi);
+		}
+		if (t1 < 0) {
+			t1 = 0;
+			lo = &pt;
+		}
+		if (t2 > dd) {
+			t2 = dd;
+			hi = &end;
+		}
+		if (t1 > t2)
+			return 0;
+
+		hits[0] = *lo;
+		hits[1] = *hi;
+		return 2;
+	}
+
+	int128_t t = grid_cross(origin, w, e);
+	int128_t s = grid_cross(origin, w, dir);
+	if (denom < 0) {
+		denom = -denom;
+		t = -t;
+		s = -s;
+	}
+
+	if (t < 0 || t > denom || s < 0 || s > denom)
+		return 0;
+
+	if (s == 0)
+		hits[0] = q1;
+	else if (s == denom)
+		hits[0] = q2;
+	else if (t == 0)
+		hits[0] = pt;
+	else if (t == denom)
+		hits[0] = pt + dir;
+	else if (grid_dot(dir, dir) < grid_dot(e, e)) {
+		long double ft = static_cast<long double>(t) / static_cast<long double>(denom);
+		hits[0] = { pt.x_ + dir.x_ * ft, pt.y_ + dir.y_ * ft };
+	} else {
+		long double fs = static_cast<long double>(s) / static_cast<long double>(denom);
+		hits[0] = { q1.x_ + e.x_ * fs, q1.y_ + e.y_ * fs };
+	}
+
+	return 1;
+}
+#endif
+
+#if defined(LIBNFP_USE_RATIONAL) && !defined(LIBNFP_USE_LAZY_RATIONAL)
+/**
+ * @brief Snap a segment parameter like %snap_parameter, in place.
+ */
+bool snap_parameter_rational(mpq_ptr param) {
+	static const rational_t epsilon = NFP_EPSILON;
+	static const rational_t minusEpsilon = -NFP_EPSILON;
+	static const rational_t oneMinusEpsilon = 1 - NFP_EPSILON;
+	static const rational_t onePlusEpsilon = 1 + NFP_EPSILON;
+
+	if (mpq_cmp(param, mpq(epsilon)) < 0) {
+		if (mpq_cmp(param, mpq(minusEpsilon)) < 0)
+			return false;
+		mpq_set_ui(param, 0, 1);
+	} else if (mpq_cmp(param, mpq(oneMinusEpsilon)) > 0) {
+		if (mpq_cmp(param, mpq(onePlusEpsilon)) > 0)
+			return false;
+		mpq_set_ui(param, 1, 1);
+	}
+	return true;
+}
+
+/**
+ * @brief sum += |v|
+ */
+inline void add_abs(mpq_ptr sum, mpq_srcptr v) {
+	if (mpq_sgn(v) < 0)
+		mpq_sub(sum, sum, v);
+	else
+		mpq_add(sum, sum, v);
+}
+
+/**
+ * @brief The bound of %intersect_translation below which a cross product of v and w counts as zero: (|v.x| + |v.y|) * (|w.x| + |w.y|) * epsilon
+ */
+void parallel_bound_rational(mpq_ptr bound, mpq_srcptr vx, mpq_srcptr vy, mpq_srcptr wx, mpq_srcptr wy, mpq_ptr tmp) {
+	static const rational_t epsilon = NFP_EPSILON;
+
+	mpq_abs(bound, vx);
+	add_abs(bound, vy);
+	mpq_abs(tmp, wx);
+	add_abs(tmp, wy);
+	mpq_mul(bound, bound, tmp);
+	mpq_mul(bound, bound, mpq(epsilon));
+}
+
+/**
+ * @brief Intersect the translation of a point with a segment. Same as %intersect_translation,
+ * but all intermediate values live in the scratch registers, so only the hits are written to rationals.
+ */
+size_t intersect_translation_rational(const point_t& pt, const point_t& dir, const point_t& q1, const point_t& q2, point_t hits[2]) {
+	RationalScratch& r = RationalScratch::local();
+	mpq_ptr ex = r.q(0), ey = r.q(1), wx = r.q(2), wy = r.q(3);
+	mpq_ptr denom = r.q(4), t = r.q(5), s = r.q(6), bound = r.q(7), tmp = r.q(8), tmp2 = r.q(9);
+	mpq_srcptr dx = mpq(dir.x_), dy = mpq(dir.y_);
+
+	mpq_sub(ex, mpq(q2.x_), mpq(q1.x_));
+	mpq_sub(ey, mpq(q2.y_), mpq(q1.y_));
+	mpq_sub(wx, mpq(q1.x_), mpq(pt.x_));
+	mpq_sub(wy, mpq(q1.y_), mpq(pt.y_));
+
+	//denom = dir x e
+	mpq_mul(denom, dx, ey);
+	mpq_mul(tmp, dy, ex);
+	mpq_sub(denom, denom, tmp);
+
+	//treat the segments as parallel if the sine of their angle is within epsilon
+	parallel_bound_rational(bound, dx, dy, ex, ey, tmp);
+	mpq_abs(tmp, denom);
+	if (mpq_cmp(tmp, bound) <= 0) {
+		mpq_ptr dd = r.q(10);
+		mpq_mul(dd, dx, dx);
+		mpq_mul(tmp, dy, dy);
+		mpq_add(dd, dd, tmp);
+		if (mpq_sgn(dd) == 0)
+			return 0;
+
+		//|w x dir|
+		mpq_mul(tmp, wx, dy);
+		mpq_mul(tmp2, wy, dx);
+		mpq_sub(tmp, tmp, tmp2);
+		mpq_abs(tmp, tmp);
+		parallel_bound_rational(bound, dx, dy, wx, wy, tmp2);
+		if (mpq_cmp(tmp, bound) > 0)
+			return 0;
+
+		//collinear: the hits are the ends of the overlapping part. t1 = w * dir / dd and t2 = (q2 - pt) * dir / dd
+		mpq_ptr t1 = t, t2 = s;
+		mpq_mul(t1, wx, dx);
+		mpq_mul(tmp, wy, dy);
+		mpq_add(t1, t1, tmp);
+		mpq_div(t1, t1, dd);
+		mpq_sub(tmp, mpq(q2.x_), mpq(pt.x_));
+		mpq_mul(t2, tmp, dx);
+		mpq_sub(tmp, mpq(q2.y_), mpq(pt.y_));
+		mpq_mul(tmp, tmp, dy);
+		mpq_add(t2, t2, tmp);
+		mpq_div(t2, t2, dd);
+
+		const point_t* lo = &q1;
+		const point_t* hi = &q2;
+		if (mpq_cmp(t2, t1) < 0) {
+			mpq_swap(t1, t2);
+			std::swap(lo, hi);
+		}
+		bool clampHi = false;
+		if (mpq_sgn(t1) < 0) {
+			mpq_set_ui(t1, 0, 1);
+			lo = &pt;
+		}
+		if (mpq_cmp_ui(t2, 1, 1) > 0) {
+			mpq_set_ui(t2, 1, 1);
+			clampHi = true;
+		}
+		if (mpq_cmp(t1, t2) > 0)
+			return 0;
+
+		hits[0] = *lo;
+		if (clampHi) {
+			mpq_add(mpq(hits[1].x_), mpq(pt.x_), dx);
+			mpq_add(mpq(hits[1].y_), mpq(pt.y_), dy);
+		} else {
+			hits[1] = *hi;
+		}
+		return 2;
+	}
+
+	//t = (w x e) / denom and s = (w x dir) / denom
+	mpq_mul(t, wx, ey);
+	mpq_mul(tmp, wy, ex);
+	mpq_sub(t, t, tmp);
+	mpq_div(t, t, denom);
+	mpq_mul(s, wx, dy);
+	mpq_mul(tmp, wy, dx);
+	mpq_sub(s, s, tmp);
+	mpq_div(s, s, denom);
+
+	if (!snap_parameter_rational(t) || !snap_parameter_rational(s))
+		return 0;
+
+	if (mpq_sgn(s) == 0) {
+		hits[0] = q1;
+	} else if (mpq_cmp_ui(s, 1, 1) == 0) {
+		hits[0] = q2;
+	} else if (mpq_sgn(t) == 0) {
+		hits[0] = pt;
+	} else if (mpq_cmp_ui(t, 1, 1) == 0) {
+		mpq_add(mpq(hits[0].x_), mpq(pt.x_), dx);
+		mpq_add(mpq(hits[0].y_), mpq(pt.y_), dy);
+	} else {
+		//calculate the point on the shorter segment, which is more precise
+		mpq_mul(tmp, dx, dx);
+		mpq_mul(tmp2, dy, dy);
+		mpq_add(tmp, tmp, tmp2);
+		mpq_mul(bound, ex, ex);
+		mpq_mul(tmp2, ey, ey);
+		mpq_add(bound, bound, tmp2);
+		if (mpq_cmp(tmp, bound) < 0) {
+			mpq_mul(tmp, dx, t);
+			mpq_add(mpq(hits[0].x_), mpq(pt.x_), tmp);
+			mpq_mul(tmp, dy, t);
+			mpq_add(mpq(hits[0].y_), mpq(pt.y_), tmp);
+		} else {
+			mpq_mul(tmp, ex, s);
+			mpq_add(mpq(hits[0].x_), mpq(q1.x_), tmp);
+			mpq_mul(tmp, ey, s);
+			mpq_add(mpq(hits[0].y_), mpq(q1.y_), tmp);
+		}
+	}
+
+	return 1;
+}
+#endif
+
+/**
+ * @brief Intersect the translation of a point (the segment pt -> pt + dir) with a segment.
+ * @param pt The translated point.
+ * @param dir The translation.
+ * @param q1 First point of the segment.
+ * @param q2 Second point of the segment.
+ * @param hits The array the intersection points are written to.
+ * @return The number of intersection points: 0, 1 or 2 (if the segments are collinear and overlap)
+ */
+size_t intersect_translation(const point_t& pt, const point_t& dir, const point_t& q1, const point_t& q2, point_t hits[2]) {
+#ifdef LIBNFP_USE_GRID
+	if (on_grid(pt) && on_grid(dir) && on_grid(q1) && on_grid(q2))
+		return intersect_translation_grid(pt, dir, q1, q2, hits);
+#endif
+#if defined(LIBNFP_USE_RATIONAL) && !defined(LIBNFP_USE_LAZY_RATIONAL)
+	return intersect_translation_rational(pt, dir, q1, q2, hits);
+#endif
+	point_t e = q2 - q1;
+	point_t w = q1 - pt;
+	coord_t denom = dir.x_ * e.y_ - dir.y_ * e.x_;
+	coord_t dirLen = bg::math::abs(dir.x_) + bg::math::abs(dir.y_);
+
+	//treat the segments as parallel if the sine of their angle is within epsilon
+	if (bg::math::abs(denom) <= dirLen * (bg::math::abs(e.x_) + bg::math::abs(e.y_)) * NFP_EPSILON) {
+		coord_t dd = dir.x_ * dir.x_ + dir.y_ * dir.y_;
+		if (dd == 0 || bg::math::abs(w.x_ * dir.y_ - w.y_ * dir.x_) > dirLen * (bg::math::abs(w.x_) + bg::math::abs(w.y_)) * NFP_EPSILON)
+			return 0;
+
+		//collinear: the hits are the ends of the overlapping part
+		point_t end = pt + dir;
+		coord_t t1 = (w.x_ * dir.x_ + w.y_ * dir.y_) / dd;
+		coord_t t2 = ((q2.x_ - pt.x_) * dir.x_ + (q2.y_ - pt.y_) * dir.y_) / dd;
+		const point_t* lo = &q1;
+		const point_t* hi = &q2;
+		if (t2 < t1) {
+			std::swap(t1, t2);
+			std::swap(lo, hi);
+		}
+		if (t1 < 0) {
+			t1 = 0;
+			lo = &pt;
+		}
+		if (t2 > 1) {
+			t2 = 1;
+			hi = &end;
+		}
+		if (t1 > t2)
+			return 0;
+
+		hits[0] = *lo;
+		hits[1] = *hi;
+		return 2;
+	}
+
+	coord_t t = (w.x_ * e.y_ - w.y_ * e.x_) / denom;
+	coord_t s = (w.x_ * dir.y_ - w.y_ * dir.x_) / denom;
+
+	if (!snap_parameter(t) || !snap_parameter(s))
+		return 0;
+
+	if (s == 0)
+		hits[0] = q1;
+	else if (s == 1)
+		hits[0] = q2;
+	else if (t == 0)
+		hits[0] = pt;
+	else if (t == 1)
+		hits[0] = pt + dir;
+	else if (dir.x_ * dir.x_ + dir.y_ * dir.y_ < e.x_ * e.x_ + e.y_ * e.y_)
+		//calculate the point on the shorter segment, which is more precise
+		hits[0] = { pt.x_ + dir.x_ * t, pt.y_ + dir.y_ * t };
+	else
+		hits[0] = { q1.x_ + e.x_ * s, q1.y_ + e.y_ * s };
+
+	return 1;
+}
+
+/**
+ * @brief Find the nearest point where the translation of a point (pt -> pt + dir) hits a ring.
+ * Only hits that are further away than NFP_EPSILON and nearer than shortest are considered.
+ * @param ring The ring in local coordinates.
+ * @param offset The current translation of the ring.
+ * @param index The %EdgeIndex of the ring in local coordinates.
+ * @param pt The translated point.
+ * @param dir The translation.
+ * @param shortest The distance of the nearest hit found so far. Updated if a nearer hit is found.
+ * @param nearest The nearest hit. Only written to if a nearer hit is found.
+ * @return true if a nearer hit was found.
+ */
+bool cast_translation(const SoaRing& ring, const point_t& offset, const EdgeIndex& index, const point_t& pt, const point_t& dir, coord_t& shortest, point_t& nearest) {
+	static const coord_t epsilon = NFP_EPSILON;
+	bool found = false;
+	point_t hits[2];
+	point_t q1;
+	point_t q2;
+	coord_t len;
+	point_t local = pt - offset;
+
+	auto test = [&](const psize_t& i) {
+		ring.translated(i, offset, q1);
+		ring.translated(i + 1, offset, q2);
+		size_t cnt = intersect_translation(pt, dir, q1, q2, hits);
+		for (size_t j = 0; j < cnt; ++j) {
+			assign_length(len, pt, hits[j]);
+			if (smaller(epsilon, len) && smaller(len, shortest)) {
+				nearest = hits[j];
+				shortest = len;
+				found = true;
+			}
+		}
+	};
+
+#ifdef LIBNFP_USE_DOUBLE
+	//the edges are collected into batches for the vectorized filter, the ones it can't reject are intersected in the same order as without it
+	if (simd_level() != SIMD_SCALAR) {
+		const coord_t* xs = ring.xs();
+		const coord_t* ys = ring.ys();
+		const double offX = offset.x_.val();
+		const double offY = offset.y_.val();
+		RayLanes lanes = RayLanes();
+		psize_t edges[SIMD_BATCH];
+		size_t n = 0;
+		auto flush = [&]() {
+			uint32_t mask = ray_mask(pt, dir, lanes, n);
+			for (size_t k = 0; k < n; ++k) {
+				if (mask & (uint32_t(1) << k))
+					test(edges[k]);
+			}
+			n = 0;
+		};
+
+		index.for_each(make_box(local, local + dir), [&](const psize_t& i) {
+			edges[n] = i;
+			lanes.q1x_[n] = xs[i].val() + offX;
+			lanes.q1y_[n] = ys[i].val() + offY;
+			lanes.q2x_[n] = xs[i + 1].val() + offX;
+			lanes.q2y_[n] = ys[i + 1].val() + offY;
+			if (++n == SIMD_BATCH)
+				flush();
+		});
+		if (n > 0)
+			flush();
+		return found;
+	}
+#endif
+
+	index.for_each(make_box(local, local + dir), test);
+	return found;
+}
+
 /**
  * @brief Trim a given translation vector so that it doesn't intersect with either rA or rB.
  * @param rA Ring of A.
- * @param rB Ring of B.
+ * @param indexA The %EdgeIndex of rA.
+ * @param rB Ring of B in local coordinates.
+ * @param offsetB The current translation of rB.
+ * @param indexB The %EdgeIndex of rB in local coordinates.
  * @param tv The given translation vector
  * @return The trimmed translation vector
  */
-TranslationVector trim_vector(const polygon_t::ring_type& rA, const polygon_t::ring_type& rB, const TranslationVector& tv) {
+TranslationVector trim_vector(const SoaRing& rA, const EdgeIndex& indexA, const SoaRing& rB, const point_t& offsetB, const EdgeIndex& indexB, const TranslationVector& tv) {
+	static const point_t origin;
 	coord_t shortest = bg::length(tv.edge_);
 	TranslationVector trimmed = tv;
-	for (const auto& ptA : rA) {
-		//for polygon A we invert the translation
-		point_t translated = { ptA.x_ - tv.vector_.x_, ptA.y_ - tv.vector_.y_};
-		linestring_t projection;
-		segment_t segproj(ptA, translated);
-		projection.push_back(ptA);
-		projection.push_back(translated);
-		std::vector<point_t> intersections;
-		bg::intersection(rB, projection, intersections);
-		if (intersections.size() < 2) {
-			bool found = false;
-			for (const auto& ptB : rB) {
-				if(equals(ptA,ptB)) {
-					found = true;
-					break;
-				}
-			}
-			if(found)
-				continue;
-		}
+	point_t inverse = flip(tv.vector_);
+	point_t hit;
+	point_t ptA;
+	point_t ptB;
 
-		//find shortest intersection
-		coord_t len;
-		segment_t segi;
-		for (const auto& pti : intersections) {
-			segi = segment_t(ptA, pti);
-			len = bg::length(segi);
-			if (smaller(NFP_EPSILON, len) && smaller(len, shortest)) {
-				trimmed.vector_ = ptA - pti;
-				trimmed.edge_ = segi;
-				shortest = len;
-			}
+	for (psize_t i = 0; i + 1 < rA.size(); ++i) {
+		rA.get(i, ptA);
+		//for polygon A we invert the translation
+		if (cast_translation(rB, offsetB, indexB, ptA, inverse, shortest, hit)) {
+			trimmed.vector_ = ptA - hit;
+			trimmed.edge_ = segment_t(ptA, hit);
 		}
 	}
 
-	for (const auto& ptB : rB) {
-		point_t translated = { ptB.x_ + tv.vector_.x_, ptB.y_ + tv.vector_.y_};
-		linestring_t projection;
-		segment_t segproj(ptB, translated);
-		projection.push_back(ptB);
-		projection.push_back(translated);
-		std::vector<point_t> intersections;
-		bg::intersection(rA, projection, intersections);
-		if (intersections.size() < 2) {
-			bool found = false;
-			for (const auto& ptA : rA) {
-				if(equals(ptB, ptA)) {
-					found = true;
-					break;
-				}
-			}
-			if(found)
-				continue;
-		}
-		//find shortest intersection
-		coord_t len;
-		segment_t segi;
-		for (const auto& pti : intersections) {
-
-			segi = segment_t(ptB, pti);
-			len = bg::length(segi);
-			if (smaller(NFP_EPSILON, len) && smaller(len, shortest)) {
-				trimmed.vector_ = pti - ptB;
-				trimmed.edge_ = segi;
-				shortest = len;
-			}
+	for (psize_t i = 0; i + 1 < rB.size(); ++i) {
+		rB.translated(i, offsetB, ptB);
+		if (cast_translation(rA, origin, indexA, ptB, tv.vector_, shortest, hit)) {
+			trimmed.vector_ = hit - ptB;
+			trimmed.edge_ = segment_t(ptB, hit);
 		}
 	}
 	return trimmed;
 }
+
+/**
+ * @brief Trim a given translation vector so that it doesn't intersect with either rA or rB.
+ * @param rA Ring of A.
+ * @param rB Ring of B.
+ * @param tv The given translation vector
+ * @return The trimmed translation vector
+ */
+TranslationVector trim_vector(const polygon_t::ring_type& rA, const polygon_t::ring_type& rB, const TranslationVector& tv) {
+	return trim_vector(SoaRing(rA), EdgeIndex(rA), SoaRing(rB), point_t(0, 0), EdgeIndex(rB), tv);
+}
+}
 }
 
 #endif /* SRC_ALGO_TRIM_VECTOR_HPP_ */
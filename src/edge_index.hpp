@@ -0,0 +1,89 @@
+#ifndef SRC_EDGE_INDEX_HPP_
+#define SRC_EDGE_INDEX_HPP_
+
+#include <vector>
+
+#include <boost/geometry/index/rtree.hpp>
+#include <boost/iterator/function_output_iterator.hpp>
+
+#include "geometry.hpp"
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+namespace bgi = boost::geometry::index;
+
+typedef bg::model::box<pointf_t> boxf_t;
+
+/**
+ * @brief Create the bounding box of a segment, grown by a margin that covers the tolerance of %equals and of the boost point/segment predicates.
+ * @param p1 First point of the segment.
+ * @param p2 Second point of the segment.
+ * @return The grown bounding box.
+ */
+boxf_t make_box(const point_t& p1, const point_t& p2) {
+	long double x1 = toLongDouble(p1.x_);
+	long double y1 = toLongDouble(p1.y_);
+	long double x2 = toLongDouble(p2.x_);
+	long double y2 = toLongDouble(p2.y_);
+	long double margin = 16 * NFP_EPSILON * std::max({ 1.0L, std::fabs(x1), std::fabs(y1), std::fabs(x2), std::fabs(y2) });
+
+	return boxf_t( { std::min(x1, x2) - margin, std::min(y1, y2) - margin }, { std::max(x1, x2) + margin, std::max(y1, y2) + margin });
+}
+
+/**
+ * @brief A spatial index (rtree) over the edges of a ring.
+ * Edge i is the segment from ring[i] to ring[i + 1].
+ */
+class EdgeIndex {
+public:
+	typedef std::pair<boxf_t, psize_t> value_t;
+private:
+	bgi::rtree<value_t, bgi::rstar<16>> tree_;
+
+	static std::vector<value_t> make_values(const polygon_t::ring_type& ring) {
+		std::vector<value_t> values;
+		for (psize_t i = 0; i + 1 < ring.size(); ++i) {
+			values.push_back( { make_box(ring[i], ring[i + 1]), i });
+		}
+		return values;
+	}
+public:
+	/**
+	 * @brief Build the index for the given ring.
+	 * @param ring The (closed) ring to index.
+	 */
+	explicit EdgeIndex(const polygon_t::ring_type& ring) :
+			tree_(make_values(ring)) {
+	}
+
+	/**
+	 * @brief Find all edges whose (grown) bounding box intersects the given box.
+	 * @param box The box to query.
+	 * @param out Output iterator receiving %value_t elements.
+	 * @return The number of edges found.
+	 */
+	template<typename OutputIterator>
+	size_t query(const boxf_t& box, OutputIterator out) const {
+		return tree_.query(bgi::intersects(box), out);
+	}
+
+	/**
+	 * @brief Call a function for every edge whose (grown) bounding box intersects the given box.
+	 * @param box The box to query.
+	 * @param fn The function to call with the index of each edge found.
+	 */
+	template<typename Function>
+	void for_each(const boxf_t& box, Function fn) const {
+		tree_.query(bgi::intersects(box), boost::make_function_output_iterator([&](const value_t& v) {
+			fn(v.second);
+		}));
+	}
+
+	size_t size() const {
+		return tree_.size();
+	}
+};
+}
+}
+
+#endif /* SRC_EDGE_INDEX_HPP_ */
@@ -5,6 +5,14 @@
 #include <string>
 #include <exception>
 #include <limits>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+//the lazy rationals replace rational_t as the coordinate type, the exact code paths of LIBNFP_USE_RATIONAL are shared
+#if defined(LIBNFP_USE_LAZY_RATIONAL) && !defined(LIBNFP_USE_RATIONAL)
+#define LIBNFP_USE_RATIONAL
+#endif
 
 #ifdef LIBNFP_USE_RATIONAL
 #include <boost/multiprecision/gmp.hpp>
@@ -17,13 +25,36 @@
 #include <boost/geometry/geometries/linestring.hpp>
 #include <boost/geometry/geometries/register/point.hpp>
 
+#include "predicates.hpp"
+#ifdef LIBNFP_USE_LAZY_RATIONAL
+#include "lazy_rational.hpp"
+#endif
+
 #ifdef LIBNFP_USE_RATIONAL
 namespace bm = boost::multiprecision;
 #endif
 namespace bg = boost::geometry;
 namespace trans = boost::geometry::strategy::transform;
 
+#if (defined(LIBNFP_USE_RATIONAL) + defined(LIBNFP_USE_DOUBLE) + defined(LIBNFP_USE_GRID)) > 1
+#error "LIBNFP_USE_RATIONAL (or LIBNFP_USE_LAZY_RATIONAL), LIBNFP_USE_DOUBLE and LIBNFP_USE_GRID are mutually exclusive"
+#endif
+
+//each coordinate backend lives in its own inline namespace, so translation units using different backends can be linked into one binary
+#if defined(LIBNFP_USE_LAZY_RATIONAL)
+#define LIBNFP_BACKEND lazy_rational_backend
+#elif defined(LIBNFP_USE_RATIONAL)
+#define LIBNFP_BACKEND rational_backend
+#elif defined(LIBNFP_USE_DOUBLE)
+#define LIBNFP_BACKEND double_backend
+#elif defined(LIBNFP_USE_GRID)
+#define LIBNFP_BACKEND grid_backend
+#else
+#define LIBNFP_BACKEND long_double_backend
+#endif
+
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
 #ifdef NFP_DEBUG
 #define DEBUG_VAL(x) std::cerr << x << std::endl
 #define DEBUG_MSG(title, value) std::cerr << title << ": " << value << std::endl
@@ -36,215 +67,204 @@ using std::string;
 
 static constexpr long double NFP_EPSILON = 0.00000001;
 
-class LongDouble {
+/**
+ * @brief A floating point coordinate. Wraps the native type to give the boost predicates the tolerance of %NFP_EPSILON.
+ * @tparam T The native floating point type.
+ */
+template<typename T>
+class FloatCoord {
 private:
-	long double val_;
+	T val_;
 	public:
-	LongDouble() :
+	typedef T value_type;
+
+	FloatCoord() :
 			val_(0) {
 	}
 
-	LongDouble(const long double& val) :
+	FloatCoord(const T& val) :
 			val_(val) {
 	}
 
-	void setVal(const long double& v) {
+	void setVal(const T& v) {
 		val_ = v;
 	}
 
-	long double val() const {
+	T val() const {
 		return val_;
 	}
 
-	LongDouble operator/(const LongDouble& other) const {
+	FloatCoord operator/(const FloatCoord& other) const {
 		return this->val_ / other.val_;
 	}
 
-	LongDouble operator*(const LongDouble& other) const {
+	FloatCoord operator*(const FloatCoord& other) const {
 		return this->val_ * other.val_;
 	}
 
-	LongDouble operator-(const LongDouble& other) const {
+	FloatCoord operator-(const FloatCoord& other) const {
 		return this->val_ - other.val_;
 	}
 
-	LongDouble operator-() const {
+	FloatCoord operator-() const {
 		return this->val_ * -1;
 	}
 
-	LongDouble operator+(const LongDouble& other) const {
+	FloatCoord operator+(const FloatCoord& other) const {
 		return this->val_ + other.val_;
 	}
 
-	void operator/=(const LongDouble& other) {
+	void operator/=(const FloatCoord& other) {
 		this->val_ = this->val_ / other.val_;
 	}
 
-	void operator*=(const LongDouble& other) {
+	void operator*=(const FloatCoord& other) {
 		this->val_ = this->val_ * other.val_;
 	}
 
-	void operator-=(const LongDouble& other) {
+	void operator-=(const FloatCoord& other) {
 		this->val_ = this->val_ - other.val_;
 	}
 
-	void operator+=(const LongDouble& other) {
+	void operator+=(const FloatCoord& other) {
 		this->val_ = this->val_ + other.val_;
 	}
 
-	bool operator==(const int& other) const {
-		return this->operator ==(static_cast<long double>(other));
+	bool operator==(const FloatCoord& other) const {
+		return this->val() == other.val();
 	}
 
-	bool operator==(const LongDouble& other) const {
-		return this->operator ==(other.val());
-	}
-
-	bool operator==(const long double& other) const {
+	template<typename U, typename = typename std::enable_if<std::is_arithmetic<U>::value>::type>
+	bool operator==(const U& other) const {
 		return this->val() == other;
 	}
 
-	bool operator!=(const int& other) const {
-		return !this->operator ==(other);
-	}
-
-	bool operator!=(const LongDouble& other) const {
+	bool operator!=(const FloatCoord& other) const {
 		return !this->operator ==(other);
 	}
 
-	bool operator!=(const long double& other) const {
+	template<typename U, typename = typename std::enable_if<std::is_arithmetic<U>::value>::type>
+	bool operator!=(const U& other) const {
 		return !this->operator ==(other);
 	}
 
-	bool operator<(const int& other) const {
-		return this->operator <(static_cast<long double>(other));
+	bool operator<(const FloatCoord& other) const {
+		return this->val() < other.val();
 	}
 
-	bool operator<(const LongDouble& other) const {
-		return this->operator <(other.val());
-	}
-
-	bool operator<(const long double& other) const {
+	template<typename U, typename = typename std::enable_if<std::is_arithmetic<U>::value>::type>
+	bool operator<(const U& other) const {
 		return this->val() < other;
 	}
 
-	bool operator<(const double& other) const {
-		return this->val() < other;
-	}
-
-	bool operator>(const int& other) const {
-		return this->operator >(static_cast<long double>(other));
-	}
-
-	bool operator>(const LongDouble& other) const {
-		return this->operator >(other.val());
+	bool operator>(const FloatCoord& other) const {
+		return this->val() > other.val();
 	}
 
-	bool operator>(const long double& other) const {
+	template<typename U, typename = typename std::enable_if<std::is_arithmetic<U>::value>::type>
+	bool operator>(const U& other) const {
 		return this->val() > other;
 	}
 
-	bool operator>=(const int& other) const {
-		return this->operator >=(static_cast<long double>(other));
-	}
-
-	bool operator>=(const LongDouble& other) const {
-		return this->operator >=(other.val());
+	bool operator>=(const FloatCoord& other) const {
+		return this->val() >= other.val();
 	}
 
-	bool operator>=(const long double& other) const {
+	template<typename U, typename = typename std::enable_if<std::is_arithmetic<U>::value>::type>
+	bool operator>=(const U& other) const {
 		return this->val() >= other;
 	}
 
-	bool operator<=(const int& other) const {
-		return this->operator <=(static_cast<long double>(other));
+	bool operator<=(const FloatCoord& other) const {
+		return this->val() <= other.val();
 	}
 
-	bool operator<=(const LongDouble& other) const {
-		return this->operator <=(other.val());
-	}
-
-	bool operator<=(const long double& other) const {
+	template<typename U, typename = typename std::enable_if<std::is_arithmetic<U>::value>::type>
+	bool operator<=(const U& other) const {
 		return this->val() <= other;
 	}
 };
+
+typedef FloatCoord<long double> LongDouble;
+typedef FloatCoord<double> Double;
+}
 }
 
 namespace std {
-template<>
-struct numeric_limits<libnfporb::LongDouble>
+template<typename T>
+struct numeric_limits<libnfporb::FloatCoord<T>>
 {
 	static constexpr bool is_specialized = true;
 
-	static constexpr long double
+	static constexpr T
 	min() noexcept {
-		return std::numeric_limits<long double>::min();
+		return std::numeric_limits<T>::min();
 	}
 
-	static constexpr long double
+	static constexpr T
 	max() noexcept {
-		return std::numeric_limits<long double>::max();
+		return std::numeric_limits<T>::max();
 	}
 
 #if __cplusplus >= 201103L
-	static constexpr long double
+	static constexpr T
 	lowest() noexcept {
-		return -std::numeric_limits<long double>::lowest();
+		return -std::numeric_limits<T>::lowest();
 	}
 #endif
 
-	static constexpr int digits = std::numeric_limits<long double>::digits;
-	static constexpr int digits10 = std::numeric_limits<long double>::digits10;
+	static constexpr int digits = std::numeric_limits<T>::digits;
+	static constexpr int digits10 = std::numeric_limits<T>::digits10;
 	#if __cplusplus >= 201103L
 	static constexpr int max_digits10
-	= std::numeric_limits<long double>::max_digits10;
+	= std::numeric_limits<T>::max_digits10;
 	#endif
 	static constexpr bool is_signed = true;
 	static constexpr bool is_integer = false;
 	static constexpr bool is_exact = false;
-	static constexpr int radix = std::numeric_limits<long double>::radix;
+	static constexpr int radix = std::numeric_limits<T>::radix;
 
-	static constexpr long double
+	static constexpr T
 	epsilon() noexcept {
 		return libnfporb::NFP_EPSILON;
 	}
 
-	static constexpr long double
+	static constexpr T
 	round_error() noexcept {
 		return 0.5L;
 	}
 
-	static constexpr int min_exponent = std::numeric_limits<long double>::min_exponent;
-	static constexpr int min_exponent10 = std::numeric_limits<long double>::min_exponent10;
-	static constexpr int max_exponent = std::numeric_limits<long double>::max_exponent;
-	static constexpr int max_exponent10 = std::numeric_limits<long double>::max_exponent10;
+	static constexpr int min_exponent = std::numeric_limits<T>::min_exponent;
+	static constexpr int min_exponent10 = std::numeric_limits<T>::min_exponent10;
+	static constexpr int max_exponent = std::numeric_limits<T>::max_exponent;
+	static constexpr int max_exponent10 = std::numeric_limits<T>::max_exponent10;
 
-	static constexpr bool has_infinity = std::numeric_limits<long double>::has_infinity;
-	static constexpr bool has_quiet_NaN = std::numeric_limits<long double>::has_quiet_NaN;
+	static constexpr bool has_infinity = std::numeric_limits<T>::has_infinity;
+	static constexpr bool has_quiet_NaN = std::numeric_limits<T>::has_quiet_NaN;
 	static constexpr bool has_signaling_NaN = has_quiet_NaN;
 	static constexpr float_denorm_style has_denorm
-	= std::numeric_limits<long double>::has_denorm;
+	= std::numeric_limits<T>::has_denorm;
 	static constexpr bool has_denorm_loss
-	= std::numeric_limits<long double>::has_denorm_loss;
+	= std::numeric_limits<T>::has_denorm_loss;
 
-	static constexpr long double
+	static constexpr T
 	infinity() noexcept {
-		return std::numeric_limits<long double>::infinity();
+		return std::numeric_limits<T>::infinity();
 	}
 
-	static constexpr long double
+	static constexpr T
 	quiet_NaN() noexcept {
-		return std::numeric_limits<long double>::quiet_NaN();
+		return std::numeric_limits<T>::quiet_NaN();
 	}
 
-	static constexpr long double
+	static constexpr T
 	signaling_NaN() noexcept {
-		return std::numeric_limits<long double>::signaling_NaN();
+		return std::numeric_limits<T>::signaling_NaN();
 	}
 
-	static constexpr long double
+	static constexpr T
 	denorm_min() noexcept {
-		return std::numeric_limits<long double>::denorm_min();
+		return std::numeric_limits<T>::denorm_min();
 	}
 
 	static constexpr bool is_iec559
@@ -253,9 +273,9 @@ struct numeric_limits<libnfporb::LongDouble>
 	static constexpr bool is_bounded = true;
 	static constexpr bool is_modulo = false;
 
-	static constexpr bool traps = std::numeric_limits<long double>::traps;
+	static constexpr bool traps = std::numeric_limits<T>::traps;
 	static constexpr bool tinyness_before =
-			std::numeric_limits<long double>::tinyness_before;
+			std::numeric_limits<T>::tinyness_before;
 	static constexpr float_round_style round_style =
 			round_to_nearest;
 };
@@ -263,11 +283,11 @@ struct numeric_limits<libnfporb::LongDouble>
 
 namespace boost {
 namespace numeric {
-template<>
-struct raw_converter<boost::numeric::conversion_traits<double, libnfporb::LongDouble>>
+template<typename T>
+struct raw_converter<boost::numeric::conversion_traits<double, libnfporb::FloatCoord<T>>>
 {
-	typedef typename boost::numeric::conversion_traits<double, libnfporb::LongDouble>::result_type result_type;
-	typedef typename boost::numeric::conversion_traits<double, libnfporb::LongDouble>::argument_type argument_type;
+	typedef typename boost::numeric::conversion_traits<double, libnfporb::FloatCoord<T>>::result_type result_type;
+	typedef typename boost::numeric::conversion_traits<double, libnfporb::FloatCoord<T>>::argument_type argument_type;
 
 	static result_type low_level_convert(argument_type s) {
 		return s.val();
@@ -277,21 +297,43 @@ struct raw_converter<boost::numeric::conversion_traits<double, libnfporb::LongDo
 }
 
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
 
-#ifndef LIBNFP_USE_RATIONAL
-typedef LongDouble coord_t;
-#else
+#if defined(LIBNFP_USE_RATIONAL)
 typedef bm::number<bm::gmp_rational, bm::et_off> rational_t;
+#ifdef LIBNFP_USE_LAZY_RATIONAL
+typedef LazyRational coord_t;
+#else
 typedef rational_t coord_t;
 #endif
+#elif defined(LIBNFP_USE_DOUBLE)
+typedef Double coord_t;
+#else
+typedef LongDouble coord_t;
+#endif
 
 bool equals(const LongDouble& lhs, const LongDouble& rhs);
 #ifdef LIBNFP_USE_RATIONAL
-bool equals(const rational_t& lhs, const rational_t& rhs);
+bool equals(const coord_t& lhs, const coord_t& rhs);
+#endif
+#ifdef LIBNFP_USE_DOUBLE
+bool equals(const Double& lhs, const Double& rhs);
 #endif
 
+#ifdef LIBNFP_USE_RATIONAL
+//rationals are unbounded and their numeric_limits<>::max() is zero, so the largest double serves as the bound
+const coord_t MAX_COORD = std::numeric_limits<double>::max();
+#else
 const coord_t MAX_COORD = std::numeric_limits<coord_t>::max();
-const coord_t MIN_COORD = std::numeric_limits<coord_t>::max() * -1;
+#endif
+const coord_t MIN_COORD = MAX_COORD * -1;
+
+/**
+ * The grid backend expects the input in grid units (see %snap_to_grid). Integral values below this bound are exactly representable,
+ * their differences fit into 64 bit and the cross products of the differences into 128 bit.
+ * It is 2^62 if long double has a 64 bit mantissa and 2^52 if it is just a double.
+ */
+static constexpr long double GRID_LIMIT = std::numeric_limits<long double>::digits >= 64 ? 4611686018427387904.0L : 4503599627370496.0L;
 
 class point_t {
 public:
@@ -301,7 +343,6 @@ public:
 	point_t(coord_t x, coord_t y) :
 			x_(x), y_(y) {
 	}
-	bool marked_ = false;
 	coord_t x_;
 	coord_t y_;
 
@@ -327,8 +368,128 @@ inline long double toLongDouble(const LongDouble& c) {
 }
 
 #ifdef LIBNFP_USE_RATIONAL
+/**
+ * @brief Scratch registers for the rational kernels, one set per thread (see %local).
+ * The registers keep their limbs between the calls, so once they have grown to the size of the coordinates
+ * the kernels don't allocate anymore. A kernel owns all registers until it returns, so kernels must not call each other.
+ */
+class RationalScratch {
+public:
+	static constexpr size_t SIZE = 12;
+
+	RationalScratch() {
+		for (size_t i = 0; i < SIZE; ++i) {
+			mpz_init(z_[i]);
+			mpq_init(q_[i]);
+		}
+	}
+
+	~RationalScratch() {
+		for (size_t i = 0; i < SIZE; ++i) {
+			mpz_clear(z_[i]);
+			mpq_clear(q_[i]);
+		}
+	}
+
+	RationalScratch(const RationalScratch&) = delete;
+	RationalScratch& operator=(const RationalScratch&) = delete;
+
+	mpz_ptr z(size_t i) {
+		return z_[i];
+	}
+
+	mpq_ptr q(size_t i) {
+		return q_[i];
+	}
+
+	/**
+	 * @return The registers of the calling thread.
+	 */
+	static RationalScratch& local() {
+		static thread_local RationalScratch scratch;
+		return scratch;
+	}
+private:
+	mpz_t z_[SIZE];
+	mpq_t q_[SIZE];
+};
+
+inline mpq_srcptr mpq(const rational_t& c) {
+	return c.backend().data();
+}
+
+inline mpq_ptr mpq(rational_t& c) {
+	return c.backend().data();
+}
+
+/**
+ * @brief Round an integer to the nearest long double, ties to even. That is what boost's convert_to<long double>() does,
+ * but it takes the detour through a decimal string and copies the integer.
+ * @param z The integer.
+ * @param scratch A register for the magnitude of z.
+ * @return The rounded integer, or +/- the largest long double if it is out of range.
+ */
+inline long double to_long_double(mpz_srcptr z, mpz_ptr scratch) {
+	const size_t digits = std::numeric_limits<long double>::digits;
+	const size_t bits = mpz_sizeinbase(z, 2);
+	const size_t shift = bits > digits ? bits - digits : 0;
+	bool roundUp = false;
+
+	mpz_abs(scratch, z);
+	if (shift > 0) {
+		roundUp = mpz_tstbit(scratch, shift - 1) && (mpz_scan1(scratch, 0) < shift - 1 || mpz_tstbit(scratch, shift));
+		mpz_tdiv_q_2exp(scratch, scratch, shift);
+	}
+
+	//the mantissa has at most digits bits, so it is accumulated exactly
+	long double m = 0;
+	for (size_t i = mpz_size(scratch); i-- > 0;)
+		m = m * std::ldexp(1.0L, GMP_NUMB_BITS) + mpz_getlimbn(scratch, i);
+	if (roundUp)
+		m += 1;
+	m = std::ldexp(m, shift);
+	if (std::isinf(m))
+		m = std::numeric_limits<long double>::max();
+
+	return mpz_sgn(z) < 0 ? -m : m;
+}
+
+/**
+ * @brief Set a rational to the exact value of a finite long double. Same as assigning the long double, but without the temporaries boost creates.
+ * @param q The rational.
+ * @param v The long double.
+ */
+inline void set_long_double(mpq_ptr q, long double v) {
+	const int digits = std::numeric_limits<long double>::digits;
+	int e;
+	//the mantissa as an integer
+	long double m = std::ldexp(std::frexp(std::fabs(v), &e), digits);
+	mpz_ptr num = mpq_numref(q);
+
+	//assembled from 32 bit parts, because unsigned long might only have 32 bits
+	mpz_set_ui(num, 0);
+	for (int remaining = digits; remaining > 0;) {
+		int bits = std::min(remaining, 32);
+		remaining -= bits;
+		long double part = std::floor(std::ldexp(m, -remaining));
+		m -= std::ldexp(part, remaining);
+		mpz_mul_2exp(num, num, bits);
+		mpz_add_ui(num, num, static_cast<unsigned long>(part));
+	}
+	mpz_set_ui(mpq_denref(q), 1);
+
+	e -= digits;
+	if (e > 0)
+		mpq_mul_2exp(q, q, e);
+	else if (e < 0)
+		mpq_div_2exp(q, q, -e);
+	if (v < 0)
+		mpq_neg(q, q);
+}
+
 inline long double toLongDouble(const rational_t& c) {
-	return bm::numerator(c).convert_to<long double>() / bm::denominator(c).convert_to<long double>();
+	mpz_ptr scratch = RationalScratch::local().z(0);
+	return to_long_double(mpq_numref(mpq(c)), scratch) / to_long_double(mpq_denref(mpq(c)), scratch);
 }
 std::ostream& operator<<(std::ostream& os, const rational_t& p) {
 	os << toLongDouble(p);
@@ -336,13 +497,44 @@ std::ostream& operator<<(std::ostream& os, const rational_t& p) {
 }
 #endif
 
-std::ostream& operator<<(std::ostream& os, const LongDouble& c) {
-	os << toLongDouble(c);
+#ifdef LIBNFP_USE_LAZY_RATIONAL
+inline long double toLongDouble(const LazyRational& c) {
+	return c.approx();
+}
+std::ostream& operator<<(std::ostream& os, const LazyRational& p) {
+	os << toLongDouble(p);
 	return os;
 }
+#endif
 
-std::istream& operator>>(std::istream& is, LongDouble& c) {
-	long double val;
+#ifdef LIBNFP_USE_DOUBLE
+inline long double toLongDouble(const Double& c) {
+	return c.val();
+}
+#endif
+
+/**
+ * @brief result = a + b. Reuses the coordinates of result, so for rationals it doesn't allocate once result has grown to the size of the sum.
+ */
+inline void assign_sum(point_t& result, const point_t& a, const point_t& b) {
+#if defined(LIBNFP_USE_RATIONAL) && !defined(LIBNFP_USE_LAZY_RATIONAL)
+	mpq_add(mpq(result.x_), mpq(a.x_), mpq(b.x_));
+	mpq_add(mpq(result.y_), mpq(a.y_), mpq(b.y_));
+#else
+	result.x_ = a.x_ + b.x_;
+	result.y_ = a.y_ + b.y_;
+#endif
+}
+
+template<typename T>
+std::ostream& operator<<(std::ostream& os, const FloatCoord<T>& c) {
+	os << c.val();
+	return os;
+}
+
+template<typename T>
+std::istream& operator>>(std::istream& is, FloatCoord<T>& c) {
+	T val;
 	is >> val;
 	c.setVal(val);
 	return is;
@@ -358,25 +550,28 @@ const point_t INVALID_POINT = { MAX_COORD, MAX_COORD };
 
 typedef bg::model::segment<point_t> segment_t;
 }
+}
 
 #ifdef LIBNFP_USE_RATIONAL
-inline long double acos(const libnfporb::rational_t& r) {
+inline long double acos(const libnfporb::coord_t& r) {
 	return acos(libnfporb::toLongDouble(r));
 }
 #endif
 
-inline long double acos(const libnfporb::LongDouble& ld) {
-	return acos(libnfporb::toLongDouble(ld));
+template<typename T>
+inline T acos(const libnfporb::FloatCoord<T>& ld) {
+	return acos(ld.val());
 }
 
 #ifdef LIBNFP_USE_RATIONAL
-inline long double sqrt(const libnfporb::rational_t& r) {
+inline long double sqrt(const libnfporb::coord_t& r) {
 	return sqrt(libnfporb::toLongDouble(r));
 }
 #endif
 
-inline long double sqrt(const libnfporb::LongDouble& ld) {
-	return sqrt(libnfporb::toLongDouble(ld));
+template<typename T>
+inline T sqrt(const libnfporb::FloatCoord<T>& ld) {
+	return sqrt(ld.val());
 }
 
 BOOST_GEOMETRY_REGISTER_POINT_2D(libnfporb::point_t, libnfporb::coord_t, cs::cartesian, x_, y_)
@@ -386,56 +581,56 @@ namespace geometry {
 namespace math {
 namespace detail {
 
-template<>
-struct square_root<libnfporb::LongDouble>
+template<typename T>
+struct square_root<libnfporb::FloatCoord<T>>
 {
-	typedef libnfporb::LongDouble return_type;
+	typedef libnfporb::FloatCoord<T> return_type;
 
-	static inline libnfporb::LongDouble apply(libnfporb::LongDouble const& a) {
+	static inline libnfporb::FloatCoord<T> apply(libnfporb::FloatCoord<T> const& a) {
 		return std::sqrt(a.val());
 	}
 };
 
 #ifdef LIBNFP_USE_RATIONAL
 template <>
-struct square_root<libnfporb::rational_t>
+struct square_root<libnfporb::coord_t>
 {
-	typedef libnfporb::rational_t return_type;
+	typedef libnfporb::coord_t return_type;
 
-	static inline libnfporb::rational_t apply(libnfporb::rational_t const& a)
+	static inline libnfporb::coord_t apply(libnfporb::coord_t const& a)
 	{
 		return std::sqrt(libnfporb::toLongDouble(a));
 	}
 };
 #endif
 
-template<>
-struct abs<libnfporb::LongDouble>
+template<typename T>
+struct abs<libnfporb::FloatCoord<T>>
 {
-	static libnfporb::LongDouble apply(libnfporb::LongDouble const& value) {
-		libnfporb::LongDouble const zero = libnfporb::LongDouble();
+	static libnfporb::FloatCoord<T> apply(libnfporb::FloatCoord<T> const& value) {
+		libnfporb::FloatCoord<T> const zero = libnfporb::FloatCoord<T>();
 		return value.val() < zero.val() ? -value.val() : value.val();
 	}
 };
 
-template<>
-struct equals<libnfporb::LongDouble, false>
+template<typename T>
+struct equals<libnfporb::FloatCoord<T>, false>
 {
 	template<typename Policy>
-	static inline bool apply(libnfporb::LongDouble const& lhs, libnfporb::LongDouble const& rhs, Policy const& policy) {
+	static inline bool apply(libnfporb::FloatCoord<T> const& lhs, libnfporb::FloatCoord<T> const& rhs, Policy const& policy) {
 		if (lhs.val() == rhs.val())
 			return true;
 
-		return bg::math::detail::abs<libnfporb::LongDouble>::apply(lhs.val() - rhs.val()) <= policy.apply(lhs.val(), rhs.val()) * libnfporb::NFP_EPSILON;
+		return bg::math::detail::abs<libnfporb::FloatCoord<T>>::apply(lhs.val() - rhs.val()) <= policy.apply(lhs.val(), rhs.val()) * libnfporb::NFP_EPSILON;
 	}
 };
 
-template<>
-struct smaller<libnfporb::LongDouble>
+template<typename T>
+struct smaller<libnfporb::FloatCoord<T>>
 {
-	static inline bool apply(libnfporb::LongDouble const& lhs, libnfporb::LongDouble const& rhs) {
-		if (lhs.val() == rhs.val() || bg::math::detail::abs<libnfporb::LongDouble>::apply(lhs.val() - rhs.val()) <= libnfporb::NFP_EPSILON * std::fmax(bg::math::detail::abs<libnfporb::LongDouble>::apply(lhs.val()).val(),
-				bg::math::detail::abs<libnfporb::LongDouble>::apply(rhs.val()).val()))
+	static inline bool apply(libnfporb::FloatCoord<T> const& lhs, libnfporb::FloatCoord<T> const& rhs) {
+		if (lhs.val() == rhs.val() || bg::math::detail::abs<libnfporb::FloatCoord<T>>::apply(lhs.val() - rhs.val()) <= libnfporb::NFP_EPSILON * std::fmax(bg::math::detail::abs<libnfporb::FloatCoord<T>>::apply(lhs.val()).val(),
+				bg::math::detail::abs<libnfporb::FloatCoord<T>>::apply(rhs.val()).val()))
 			return false;
 
 		return lhs < rhs;
@@ -447,13 +642,97 @@ struct smaller<libnfporb::LongDouble>
 }
 
 namespace boost { namespace qvm {
-    template <> struct is_scalar<libnfporb::LongDouble> { static bool const value = true; };
+    template <typename T> struct is_scalar<libnfporb::FloatCoord<T>> { static bool const value = true; };
 }}
 
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+#ifdef LIBNFP_USE_GRID
+//__extension__ keeps -pedantic quiet about the non-standard type
+__extension__ typedef __int128 int128_t;
+
+/**
+ * @return true if the value lies on the grid, which means it is integral and within %GRID_LIMIT.
+ */
+inline bool on_grid(const LongDouble& c) {
+	return c.val() == std::trunc(c.val()) && std::fabs(c.val()) < GRID_LIMIT;
+}
+
+inline bool on_grid(const point_t& p) {
+	return on_grid(p.x_) && on_grid(p.y_);
+}
+
+/**
+ * @return The exact cross product (b - a) x (c - a) of points on the grid.
+ */
+inline int128_t grid_cross(const point_t& a, const point_t& b, const point_t& c) {
+	const int64_t ax = a.x_.val(), ay = a.y_.val();
+	return static_cast<int128_t>(static_cast<int64_t>(b.x_.val()) - ax) * (static_cast<int64_t>(c.y_.val()) - ay)
+			- static_cast<int128_t>(static_cast<int64_t>(b.y_.val()) - ay) * (static_cast<int64_t>(c.x_.val()) - ax);
+}
+
+/**
+ * @return The exact dot product of two vectors on the grid.
+ */
+inline int128_t grid_dot(const point_t& v, const point_t& w) {
+	return static_cast<int128_t>(static_cast<int64_t>(v.x_.val())) * static_cast<int64_t>(w.x_.val())
+			+ static_cast<int128_t>(static_cast<int64_t>(v.y_.val())) * static_cast<int64_t>(w.y_.val());
+}
+#endif
+
+#if defined(LIBNFP_USE_RATIONAL) && !defined(LIBNFP_USE_LAZY_RATIONAL)
+/**
+ * @brief The difference p - q as a fraction num / den with a positive, not necessarily reduced denominator.
+ */
+inline void rational_diff(mpz_ptr num, mpz_ptr den, mpq_srcptr p, mpq_srcptr q) {
+	if (mpz_cmp_ui(mpq_denref(p), 1) == 0 && mpz_cmp_ui(mpq_denref(q), 1) == 0) {
+		mpz_sub(num, mpq_numref(p), mpq_numref(q));
+		mpz_set_ui(den, 1);
+	} else {
+		mpz_mul(num, mpq_numref(p), mpq_denref(q));
+		mpz_submul(num, mpq_numref(q), mpq_denref(p));
+		mpz_mul(den, mpq_denref(p), mpq_denref(q));
+	}
+}
+
+/**
+ * @return The sign of the cross product (b - a) x (c - a). Numerators and denominators are cross multiplied in the scratch registers,
+ * so unlike the rational expression it neither creates temporaries nor reduces them.
+ */
+int rational_cross_sign(const point_t& a, const point_t& b, const point_t& c) {
+	RationalScratch& r = RationalScratch::local();
+	mpz_ptr bxN = r.z(0), bxD = r.z(1), byN = r.z(2), byD = r.z(3);
+	mpz_ptr cxN = r.z(4), cxD = r.z(5), cyN = r.z(6), cyD = r.z(7);
+	mpz_ptr lhsN = r.z(8), lhsD = r.z(9), rhsN = r.z(10), rhsD = r.z(11);
+
+	rational_diff(bxN, bxD, mpq(b.x_), mpq(a.x_));
+	rational_diff(byN, byD, mpq(b.y_), mpq(a.y_));
+	rational_diff(cxN, cxD, mpq(c.x_), mpq(a.x_));
+	rational_diff(cyN, cyD, mpq(c.y_), mpq(a.y_));
+
+	//compare (bx * cy) with (by * cx)
+	mpz_mul(lhsN, bxN, cyN);
+	mpz_mul(rhsN, byN, cxN);
+	mpz_mul(lhsD, bxD, cyD);
+	mpz_mul(rhsD, byD, cxD);
+	if (mpz_cmp(lhsD, rhsD) != 0) {
+		mpz_mul(lhsN, lhsN, rhsD);
+		mpz_mul(rhsN, rhsN, lhsD);
+	}
+
+	int res = mpz_cmp(lhsN, rhsN);
+	return res > 0 ? 1 : (res < 0 ? -1 : 0);
+}
+#endif
+
 bool equals(const LongDouble& lhs, const LongDouble& rhs) {
 	if (lhs.val() == rhs.val())
 		return true;
+#ifdef LIBNFP_USE_GRID
+	//values on the grid are exact, so they are only equal if they are identical
+	if (on_grid(lhs) && on_grid(rhs))
+		return false;
+#endif
 
 	return bg::math::detail::abs<libnfporb::LongDouble>::apply(lhs.val() - rhs.val()) <= libnfporb::NFP_EPSILON * std::fmax(
 			bg::math::detail::abs<libnfporb::LongDouble>::apply(lhs.val()).val(),
@@ -461,6 +740,10 @@ bool equals(const LongDouble& lhs, const LongDouble& rhs) {
 }
 
 inline bool smaller(const LongDouble& lhs, const LongDouble& rhs) {
+#ifdef LIBNFP_USE_GRID
+	if (on_grid(lhs) && on_grid(rhs))
+		return lhs.val() < rhs.val();
+#endif
 	return boost::geometry::math::detail::smaller<LongDouble>::apply(lhs, rhs);
 }
 
@@ -469,19 +752,36 @@ inline bool larger(const LongDouble& lhs, const LongDouble& rhs) {
 }
 
 #ifdef LIBNFP_USE_RATIONAL
-inline bool smaller(const rational_t& lhs, const rational_t& rhs) {
+inline bool smaller(const coord_t& lhs, const coord_t& rhs) {
 	return lhs < rhs;
 }
 
-inline bool larger(const rational_t& lhs, const rational_t& rhs) {
+inline bool larger(const coord_t& lhs, const coord_t& rhs) {
 	return smaller(rhs, lhs);
 }
 
-bool equals(const rational_t& lhs, const rational_t& rhs) {
+bool equals(const coord_t& lhs, const coord_t& rhs) {
 	return lhs == rhs;
 }
 #endif
 
+#ifdef LIBNFP_USE_DOUBLE
+bool equals(const Double& lhs, const Double& rhs) {
+	if (lhs.val() == rhs.val())
+		return true;
+
+	return std::fabs(lhs.val() - rhs.val()) <= NFP_EPSILON * std::fmax(std::fabs(lhs.val()), std::fabs(rhs.val()));
+}
+
+inline bool smaller(const Double& lhs, const Double& rhs) {
+	return boost::geometry::math::detail::smaller<Double>::apply(lhs, rhs);
+}
+
+inline bool larger(const Double& lhs, const Double& rhs) {
+	return smaller(rhs, lhs);
+}
+#endif
+
 bool equals(const point_t& lhs, const point_t& rhs) {
 	return equals(lhs.x_, rhs.x_) && equals(lhs.y_, rhs.y_);
 }
@@ -489,6 +789,36 @@ bool equals(const point_t& lhs, const point_t& rhs) {
 bool equals(const segment_t& lhs, const segment_t& rhs) {
 	return equals(lhs.first, rhs.first) && equals(lhs.second, rhs.second);
 }
+
+//number of mantissa bits per epsilon bucket. a bucket is more than 2^-24 (relative) wide, which is wider than the 4 * NFP_EPSILON a lookup probes.
+constexpr int EPSILON_BUCKET_BITS = 24;
+
+/**
+ * @brief Quantize a coordinate for hashing. The buckets are contiguous and monotone in the coordinate, so values within epsilon are in the same or in adjacent buckets.
+ * @param c The coordinate.
+ * @return The bucket of the coordinate.
+ */
+inline int64_t epsilon_bucket(const long double& c) {
+	if (c == 0)
+		return 0;
+
+	//the mantissa is in [0.5, 1), so the lower half of the buckets per exponent would never be used
+	int exp;
+	long double mantissa = std::frexp(std::fabs(c), &exp);
+	int64_t b = ((int64_t(exp) + 32768) << (EPSILON_BUCKET_BITS - 1)) + int64_t(std::ldexp(mantissa, EPSILON_BUCKET_BITS)) - (int64_t(1) << (EPSILON_BUCKET_BITS - 1));
+	return c < 0 ? -b : b;
+}
+
+/**
+ * @brief Calculate the range of the buckets (see %epsilon_bucket) of all coordinates that might equal c (see %equals).
+ * @param c The coordinate.
+ * @return The first and last bucket.
+ */
+inline std::pair<int64_t, int64_t> epsilon_bucket_range(const coord_t& c) {
+	long double v = toLongDouble(c);
+	long double margin = 2 * NFP_EPSILON * std::fabs(v);
+	return { epsilon_bucket(v - margin), epsilon_bucket(v + margin) };
+}
 std::ostream& operator<<(std::ostream& os, const segment_t& seg) {
 	os << "{" << seg.first << "," << seg.second << "}";
 	return os;
@@ -508,9 +838,32 @@ typedef bg::model::d2::point_xy<long double> pointf_t;
 typedef bg::model::segment<pointf_t> segmentf_t;
 typedef bg::model::polygon<pointf_t, false, true> polygonf_t;
 
+/**
+ * @brief result = the length of the segment p -> q, exactly as bg::length calculates it. Reuses the storage of result.
+ */
+inline void assign_length(coord_t& result, const point_t& p, const point_t& q) {
+#if defined(LIBNFP_USE_RATIONAL) && !defined(LIBNFP_USE_LAZY_RATIONAL)
+	RationalScratch& r = RationalScratch::local();
+	mpq_ptr dx = r.q(0), dy = r.q(1);
+	mpz_ptr scratch = r.z(0);
+
+	mpq_sub(dx, mpq(p.x_), mpq(q.x_));
+	mpq_mul(dx, dx, dx);
+	mpq_sub(dy, mpq(p.y_), mpq(q.y_));
+	mpq_mul(dy, dy, dy);
+	mpq_add(dx, dx, dy);
+	//the square root of a rational is taken in long double precision
+	set_long_double(mpq(result), std::sqrt(to_long_double(mpq_numref(dx), scratch) / to_long_double(mpq_denref(dx), scratch)));
+#else
+	result = bg::length(segment_t(p, q));
+#endif
+}
+
 point_t normalize(const point_t& vec) {
+	static const point_t origin;
 	point_t norm = vec;
-	coord_t len = bg::length(segment_t { { 0, 0 }, vec });
+	coord_t len;
+	assign_length(len, origin, vec);
 
 	if (len == 0.0L)
 		return {0,0};
@@ -545,19 +898,101 @@ enum Alignment {
 	ON
 };
 
+/**
+ * The exact sign of the cross product (b - a) x (c - a).
+ * Rationals are exact already (see %rational_cross_sign), the grid backend uses 128 bit integers for points on the grid
+ * and the floating point backends use the adaptive predicate (see %predicates::orient2d).
+ * @return 1 if c lies left of the directed line from a to b, -1 if it lies right of it and 0 if a, b and c are collinear.
+ */
+int orientation(const point_t& a, const point_t& b, const point_t& c) {
+#if defined(LIBNFP_USE_LAZY_RATIONAL)
+	coord_t res = ((b.x_ - a.x_) * (c.y_ - a.y_) - (b.y_ - a.y_) * (c.x_ - a.x_));
+	return res > 0 ? 1 : (res < 0 ? -1 : 0);
+#elif defined(LIBNFP_USE_RATIONAL)
+	return rational_cross_sign(a, b, c);
+#else
+#ifdef LIBNFP_USE_GRID
+	if (on_grid(a) && on_grid(b) && on_grid(c)) {
+		int128_t res = grid_cross(a, b, c);
+		return res > 0 ? 1 : (res < 0 ? -1 : 0);
+	}
+#endif
+	return predicates::orient2d(a.x_.val(), a.y_.val(), b.x_.val(), b.y_.val(), c.x_.val(), c.y_.val());
+#endif
+}
+
 Alignment get_alignment(const segment_t& seg, const point_t& pt) {
-	coord_t res = ((seg.second.x_ - seg.first.x_) * (pt.y_ - seg.first.y_)
-			- (seg.second.y_ - seg.first.y_) * (pt.x_ - seg.first.x_));
+	int res = orientation(seg.first, seg.second, pt);
 
-	if (equals(res, 0)) {
+	if (res == 0) {
 		return ON;
-	} else if (larger(res, 0)) {
+	} else if (res > 0) {
 		return LEFT;
 	} else {
 		return RIGHT;
 	}
 }
 
+#ifndef LIBNFP_USE_RATIONAL
+/**
+ * @return true if the coordinates of the points differ by no more than twice the tolerance bg::equals allows.
+ */
+bool near(const point_t& p, const point_t& q) {
+	const long double px = toLongDouble(p.x_), py = toLongDouble(p.y_), qx = toLongDouble(q.x_), qy = toLongDouble(q.y_);
+	return std::fabs(px - qx) <= 2 * NFP_EPSILON * std::fmax(std::fmax(std::fabs(px), std::fabs(qx)), 1.0L)
+			&& std::fabs(py - qy) <= 2 * NFP_EPSILON * std::fmax(std::fmax(std::fabs(py), std::fabs(qy)), 1.0L);
+}
+#endif
+
+/**
+ * Check if a point lies on a segment, end points included. Gives exactly the same results as bg::intersects(seg, pt).
+ * Rationals and, in the grid backend, points on the grid are decided exactly. For the floating point backends bg::intersects accepts points within %NFP_EPSILON of the segment,
+ * which the touching tests rely on, because the vertices of B are translated and rounded. So the determinant is evaluated in floating point
+ * with an error bound and only points it can't reject are passed on to bg::intersects.
+ * @param a The first point of the segment.
+ * @param b The second point of the segment.
+ * @param pt The point.
+ * @return true if the point is on the segment.
+ */
+bool on_segment(const point_t& a, const point_t& b, const point_t& pt) {
+#ifdef LIBNFP_USE_GRID
+	if (on_grid(a) && on_grid(b) && on_grid(pt)) {
+		if ((pt.x_ < a.x_ && pt.x_ < b.x_) || (pt.x_ > a.x_ && pt.x_ > b.x_) || (pt.y_ < a.y_ && pt.y_ < b.y_) || (pt.y_ > a.y_ && pt.y_ > b.y_))
+			return false;
+
+		return grid_cross(a, b, pt) == 0;
+	}
+#endif
+#ifdef LIBNFP_USE_RATIONAL
+	if ((pt.x_ < a.x_ && pt.x_ < b.x_) || (pt.x_ > a.x_ && pt.x_ > b.x_) || (pt.y_ < a.y_ && pt.y_ < b.y_) || (pt.y_ > a.y_ && pt.y_ > b.y_))
+		return false;
+
+	return orientation(a, b, pt) == 0;
+#else
+	typedef coord_t::value_type float_t;
+	const float_t dx = b.x_.val() - a.x_.val();
+	const float_t dy = b.y_.val() - a.y_.val();
+	const float_t dpx = pt.x_.val() - a.x_.val();
+	const float_t dpy = pt.y_.val() - a.y_.val();
+	const float_t det = dx * dpy - dy * dpx;
+
+	//bg::intersects permutes the points and rounds differently, but every variant of the determinant is within this bound
+	float_t m = std::fmax(std::fmax(std::fabs(dx), std::fabs(dy)), std::fmax(std::fabs(dpx), std::fabs(dpy)));
+	m = std::fmax(m, std::fmax(std::fabs(pt.x_.val() - b.x_.val()), std::fabs(pt.y_.val() - b.y_.val())));
+	const float_t err = 16 * std::numeric_limits<float_t>::epsilon() * m * m;
+
+	//bg::intersects treats points that equal one of the end points (within tolerance) as collinear
+	if (std::fabs(det) > 2 * NFP_EPSILON + err && !near(pt, a) && !near(pt, b) && !near(a, b))
+		return false;
+
+	return bg::intersects(segment_t(a, b), pt);
+#endif
+}
+
+bool on_segment(const segment_t& seg, const point_t& pt) {
+	return on_segment(seg.first, seg.second, pt);
+}
+
 long double get_inner_angle(const point_t& joint, const point_t& end1, const point_t& end2) {
 	coord_t dx21 = end1.x_ - joint.x_;
 	coord_t dx31 = end2.x_ - joint.x_;
@@ -662,5 +1097,6 @@ bool in_nfp(const point_t& pt, const nfp_t& nfp) {
 	return false;
 }
 }
+}
 
 #endif /* SRC_GEOMETRY_HPP_ */
@@ -0,0 +1,59 @@
+#ifndef SRC_GRID_HPP_
+#define SRC_GRID_HPP_
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "geometry.hpp"
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+/**
+ * @brief Snap a ring to a grid and express it in grid units: every coordinate is divided by the resolution and rounded.
+ * @param ring The ring to snap.
+ * @param resolution The spacing of the grid, e.g. 0.001 for a 1µm grid in millimeters.
+ * @throws runtime_error if a coordinate in grid units exceeds %GRID_LIMIT
+ */
+void snap_to_grid(polygon_t::ring_type& ring, const long double& resolution) {
+	for (auto& pt : ring) {
+		long double x = std::round(toLongDouble(pt.x_) / resolution);
+		long double y = std::round(toLongDouble(pt.y_) / resolution);
+		if (std::fabs(x) >= GRID_LIMIT || std::fabs(y) >= GRID_LIMIT)
+			throw std::runtime_error("Coordinate exceeds the grid: " + std::to_string(toLongDouble(pt.x_)) + "," + std::to_string(toLongDouble(pt.y_)));
+		pt.x_ = x;
+		pt.y_ = y;
+	}
+}
+
+/**
+ * @brief Snap a polygon to a grid and express it in grid units, which is the input the grid backend (LIBNFP_USE_GRID) is exact for.
+ * Snapping may create co-linear points and short edges, so check the result for validity (generate_nfp does by default).
+ * @param p The polygon to snap.
+ * @param resolution The spacing of the grid.
+ * @throws runtime_error if a coordinate in grid units exceeds %GRID_LIMIT
+ */
+void snap_to_grid(polygon_t& p, const long double& resolution) {
+	snap_to_grid(p.outer(), resolution);
+	for (auto& r : p.inners())
+		snap_to_grid(r, resolution);
+}
+
+/**
+ * @brief Convert a NFP computed in grid units back to the units of the input.
+ * @param nfp The NFP to convert.
+ * @param resolution The spacing of the grid the input was snapped to.
+ */
+void scale_from_grid(nfp_t& nfp, const long double& resolution) {
+	const coord_t res = resolution;
+	for (auto& r : nfp) {
+		for (auto& pt : r) {
+			pt.x_ *= res;
+			pt.y_ *= res;
+		}
+	}
+}
+}
+}
+
+#endif /* SRC_GRID_HPP_ */
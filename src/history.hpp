@@ -1,11 +1,200 @@
 #ifndef SRC_HISTORY_HPP_
 #define SRC_HISTORY_HPP_
 
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+
+#include <boost/functional/hash.hpp>
+
 #include "geometry.hpp"
 #include "translation_vector.hpp"
 
 namespace libnfporb {
-typedef std::vector<TranslationVector> History;
+inline namespace LIBNFP_BACKEND {
+/**
+ * @brief The history of performed translations.
+ * Besides the ordered log of translations it keeps a hash map from a quantized translation vector to the log indices
+ * of all translations with that vector. Since %equals is epsilon-aware a lookup probes all buckets a value within epsilon might fall into
+ * and then verifies every candidate with operator==, so lookups and counts yield exactly the same results as a linear search.
+ * The hash map is chained through a flat node array, so a cleared history is refilled without allocating until it outgrows its previous size.
+ * The quantized vectors also feed a polynomial rolling hash, so two runs of translations can be compared in constant time (see %hash).
+ */
+class History {
+public:
+	typedef std::vector<TranslationVector>::const_iterator const_iterator;
+private:
+	typedef std::pair<int64_t, int64_t> key_t;
+
+	struct node_t {
+		key_t key_;
+		//the log index of the translation
+		size_t index_;
+		//the next node of the same slot or NONE
+		size_t next_;
+	};
+
+	static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+	//the base of the rolling hash, modulo 2^64
+	static constexpr uint64_t HASH_BASE = 0x100000001b3ULL;
+
+	std::vector<TranslationVector> log_;
+	//the first node of every slot or NONE. the number of slots is a power of two.
+	std::vector<size_t> slots_;
+	std::vector<node_t> nodes_;
+	//prefix_[i] is the rolling hash of the first i translations
+	std::vector<uint64_t> prefix_;
+	//powers_[i] = HASH_BASE^i. Kept when the history is cleared.
+	std::vector<uint64_t> powers_;
+
+	static key_t make_key(const point_t& vec) {
+		return { epsilon_bucket(toLongDouble(vec.x_)), epsilon_bucket(toLongDouble(vec.y_)) };
+	}
+
+	size_t slot(const key_t& key) const {
+		return boost::hash<key_t>()(key) & (slots_.size() - 1);
+	}
+
+	/**
+	 * @brief Double the number of slots (at least 16) and chain all nodes anew.
+	 */
+	void grow() {
+		slots_.assign(std::max(size_t(16), slots_.size() * 2), size_t(NONE));
+		for (size_t n = 0; n < nodes_.size(); ++n) {
+			size_t& first = slots_[slot(nodes_[n].key_)];
+			nodes_[n].next_ = first;
+			first = n;
+		}
+	}
+
+	/**
+	 * @brief Call a function for the log index of every translation that equals tv.
+	 * @param tv The translation vector.
+	 * @param fn The function to call. Iteration stops if it returns false.
+	 */
+	template<typename Function>
+	void for_each_equal(const TranslationVector& tv, Function fn) const {
+		if (slots_.empty())
+			return;
+
+		auto rx = epsilon_bucket_range(tv.vector_.x_);
+		auto ry = epsilon_bucket_range(tv.vector_.y_);
+
+		for (int64_t bx = rx.first; bx <= rx.second; ++bx) {
+			for (int64_t by = ry.first; by <= ry.second; ++by) {
+				const key_t key(bx, by);
+				for (size_t n = slots_[slot(key)]; n != NONE; n = nodes_[n].next_) {
+					const node_t& node = nodes_[n];
+					if (node.key_ == key && log_[node.index_] == tv && !fn(node.index_))
+						return;
+				}
+			}
+		}
+	}
+public:
+	void push_back(const TranslationVector& tv) {
+		if (nodes_.size() >= slots_.size())
+			grow();
+
+		const key_t key = make_key(tv.vector_);
+		size_t& first = slots_[slot(key)];
+		nodes_.push_back( { key, log_.size(), first });
+		first = nodes_.size() - 1;
+		log_.push_back(tv);
+
+		if (prefix_.empty())
+			prefix_.push_back(0);
+		prefix_.push_back(prefix_.back() * HASH_BASE + boost::hash<key_t>()(key));
+		if (powers_.empty())
+			powers_.push_back(1);
+		while (powers_.size() < prefix_.size())
+			powers_.push_back(powers_.back() * HASH_BASE);
+	}
+
+	/**
+	 * @brief Forget all translations. The storage is kept for reuse.
+	 */
+	void clear() {
+		log_.clear();
+		nodes_.clear();
+		prefix_.clear();
+		std::fill(slots_.begin(), slots_.end(), size_t(NONE));
+	}
+
+	size_t size() const {
+		return log_.size();
+	}
+
+	bool empty() const {
+		return log_.empty();
+	}
+
+	const TranslationVector& operator[](const size_t& i) const {
+		return log_[i];
+	}
+
+	const TranslationVector& back() const {
+		return log_.back();
+	}
+
+	const_iterator begin() const {
+		return log_.begin();
+	}
+
+	const_iterator end() const {
+		return log_.end();
+	}
+
+	/**
+	 * @brief The rolling hash of a run of translations. Equal runs have equal hashes, unless two of their vectors are within epsilon of each
+	 * other but fall into different buckets, so a match still has to be verified with operator==.
+	 * @param first The log index of the first translation of the run.
+	 * @param last The log index after the last translation of the run.
+	 * @return The hash of the run.
+	 */
+	uint64_t hash(const size_t& first, const size_t& last) const {
+		return prefix_[last] - prefix_[first] * powers_[last - first];
+	}
+
+	/**
+	 * @brief Find a translation vector by comparing segment and vector.
+	 * @param tv The translation vector.
+	 * @param offset The index offset to start searching from
+	 * @return The index of the first occurrence at or after offset or -1 if there is none.
+	 */
+	off_t find(const TranslationVector& tv, const off_t& offset = 0) const {
+		if (offset < 0)
+			return -1;
+
+		off_t first = -1;
+		for_each_equal(tv, [&](const size_t& i) {
+			if (off_t(i) >= offset && (first == -1 || off_t(i) < first))
+				first = i;
+			return true;
+		});
+		return first;
+	}
+
+	/**
+	 * @brief Count the occurrences of a translation vector (by comparing segment and vector).
+	 * Like the predicate based count the first entry of the history isn't taken into account.
+	 * @param tv The translation vector.
+	 * @return The count of occurrences in the history.
+	 */
+	size_t count(const TranslationVector& tv) const {
+		size_t cnt = 0;
+		for_each_equal(tv, [&](const size_t& i) {
+			if (i > 0)
+				++cnt;
+			return true;
+		});
+		return cnt;
+	}
+};
 
 /**
  * Find a translation vector in the history using a custom predicate
@@ -36,16 +225,7 @@ off_t find(const History& h, const TranslationVector& tv, std::function<bool(con
  * @return returns The index of the translation vector or -1 if it isn't found.
  */
 off_t find(const History& h, const TranslationVector& tv, const off_t& offset = 0) {
-	if(offset < 0)
-		return -1;
-
-	for(size_t i = offset; i < h.size(); ++i) {
-		if (find(h, tv, [](const TranslationVector& lhs, const TranslationVector& rhs){ return lhs == rhs; }, offset)) {
-			return i;
-		}
-	}
-
-	return -1;
+	return h.find(tv, offset);
 }
 
 /**
@@ -68,12 +248,13 @@ off_t find(const History& h, const TranslationVector& tv, const off_t& offset =
  * @param tv The translation vector.
  * @return The count of occurrences in the history.
  */size_t count(const History& h, const TranslationVector& tv) {
-	return count(h,tv, [](const TranslationVector& lhs, const TranslationVector& rhs){ return lhs == rhs; });
+	return h.count(tv);
 }
 
 
 
 
+}
 }
 
 #endif /* SRC_HISTORY_HPP_ */
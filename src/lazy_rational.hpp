@@ -0,0 +1,480 @@
+#ifndef SRC_LAZY_RATIONAL_HPP_
+#define SRC_LAZY_RATIONAL_HPP_
+
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+#include <boost/multiprecision/gmp.hpp>
+#include <boost/multiprecision/number.hpp>
+#include <boost/numeric/conversion/converter.hpp>
+#include <boost/qvm/scalar_traits.hpp>
+
+#include "predicates.hpp"
+
+namespace libnfporb {
+class LazyRational;
+}
+
+namespace std {
+template<>
+struct numeric_limits<libnfporb::LazyRational>
+{
+	static constexpr bool is_specialized = true;
+
+	static libnfporb::LazyRational min() noexcept;
+	//rationals are unbounded, the largest double serves as the bound
+	static libnfporb::LazyRational max() noexcept;
+
+	static libnfporb::LazyRational lowest() noexcept;
+
+	static constexpr int digits = std::numeric_limits<double>::digits;
+	static constexpr int digits10 = std::numeric_limits<double>::digits10;
+	static constexpr int max_digits10 = std::numeric_limits<double>::max_digits10;
+	static constexpr bool is_signed = true;
+	static constexpr bool is_integer = false;
+	static constexpr bool is_exact = true;
+	static constexpr int radix = 2;
+
+	static libnfporb::LazyRational epsilon() noexcept;
+
+	static libnfporb::LazyRational round_error() noexcept;
+
+	static constexpr int min_exponent = 0;
+	static constexpr int min_exponent10 = 0;
+	static constexpr int max_exponent = 0;
+	static constexpr int max_exponent10 = 0;
+
+	static constexpr bool has_infinity = false;
+	static constexpr bool has_quiet_NaN = false;
+	static constexpr bool has_signaling_NaN = false;
+	static constexpr float_denorm_style has_denorm = denorm_absent;
+	static constexpr bool has_denorm_loss = false;
+
+	static libnfporb::LazyRational infinity() noexcept;
+
+	static libnfporb::LazyRational quiet_NaN() noexcept;
+
+	static libnfporb::LazyRational signaling_NaN() noexcept;
+
+	static libnfporb::LazyRational denorm_min() noexcept;
+
+	static constexpr bool is_iec559 = false;
+	static constexpr bool is_bounded = false;
+	static constexpr bool is_modulo = false;
+
+	static constexpr bool traps = false;
+	static constexpr bool tinyness_before = false;
+	static constexpr float_round_style round_style = round_toward_zero;
+};
+}
+
+namespace libnfporb {
+/**
+ * @brief An exact rational number that is only computed if it has to be.
+ * Every value carries a double interval that encloses it. Arithmetic is done on the intervals, rounded outwards,
+ * and records the operation in a node that can rebuild the exact value. A comparison is decided by the intervals if they don't overlap,
+ * only otherwise the exact values are built with GMP (and cached in the nodes).
+ * Results that are exactly representable as double (e.g. sums and products of small integers) don't need a node at all.
+ * Like predicates.hpp this doesn't depend on the coordinate backend, so it is not part of its inline namespace.
+ */
+class LazyRational {
+public:
+	typedef boost::multiprecision::number<boost::multiprecision::gmp_rational, boost::multiprecision::et_off> exact_type;
+
+private:
+	enum Op {
+		LEAF,
+		ADD,
+		SUB,
+		MUL,
+		DIV,
+		NEG
+	};
+
+	class Node;
+	typedef predicates::Arithmetic<double> Arithmetic;
+
+	//the relative width of an interval above which the exact value is built eagerly
+	static constexpr double REFRESH_WIDTH = 1.0 / (1 << 20);
+
+	double lo_;
+	double hi_;
+	//null if the value is exactly the double lo_ == hi_
+	std::shared_ptr<const Node> node_;
+
+	LazyRational(const double& lo, const double& hi, Op op, const LazyRational& lhs, const LazyRational& rhs);
+
+	static double down(const double& v) {
+		return std::nextafter(v, -std::numeric_limits<double>::infinity());
+	}
+
+	static double up(const double& v) {
+		return std::nextafter(v, std::numeric_limits<double>::infinity());
+	}
+
+	void set_exact(const exact_type& e);
+	static int compare(const LazyRational& lhs, const LazyRational& rhs);
+
+public:
+	LazyRational() :
+			lo_(0), hi_(0) {
+	}
+
+	template<typename U, typename = typename std::enable_if<std::is_arithmetic<U>::value>::type>
+	LazyRational(const U& v) {
+		double d = static_cast<double>(v);
+		if (static_cast<U>(d) == v) {
+			lo_ = hi_ = d;
+		} else {
+			//a long double or a large integer that doesn't fit into a double
+			set_exact(exact_type(v));
+		}
+	}
+
+	explicit LazyRational(const exact_type& e) {
+		set_exact(e);
+	}
+
+	/**
+	 * @return true if the value is known to be exactly %lower().
+	 */
+	bool is_double() const {
+		return !node_;
+	}
+
+	bool is_zero() const {
+		return !node_ && lo_ == 0;
+	}
+
+	bool is_one() const {
+		return !node_ && lo_ == 1;
+	}
+
+	double lower() const {
+		return lo_;
+	}
+
+	double upper() const {
+		return hi_;
+	}
+
+	/**
+	 * @return The exact value. Builds (and caches) it if necessary.
+	 */
+	exact_type exact() const;
+
+	/**
+	 * @return An approximation of the value: the middle of the interval, or the rounded exact value if the interval is wide.
+	 */
+	long double approx() const;
+
+	explicit operator double() const {
+		return static_cast<double>(approx());
+	}
+
+	explicit operator long double() const {
+		return approx();
+	}
+
+	friend LazyRational operator+(const LazyRational& lhs, const LazyRational& rhs) {
+		if (!lhs.node_ && !rhs.node_) {
+			double s, e;
+			Arithmetic::two_sum(lhs.lo_, rhs.lo_, s, e);
+			if (e == 0 && std::isfinite(s))
+				return s;
+		}
+		if (lhs.is_zero())
+			return rhs;
+		if (rhs.is_zero())
+			return lhs;
+		return LazyRational(down(lhs.lo_ + rhs.lo_), up(lhs.hi_ + rhs.hi_), ADD, lhs, rhs);
+	}
+
+	friend LazyRational operator-(const LazyRational& lhs, const LazyRational& rhs) {
+		if (!lhs.node_ && !rhs.node_) {
+			double s, e;
+			Arithmetic::two_diff(lhs.lo_, rhs.lo_, s, e);
+			if (e == 0 && std::isfinite(s))
+				return s;
+		}
+		if (rhs.is_zero())
+			return lhs;
+		if (lhs.node_ == rhs.node_)
+			return 0.0;
+		return LazyRational(down(lhs.lo_ - rhs.hi_), up(lhs.hi_ - rhs.lo_), SUB, lhs, rhs);
+	}
+
+	friend LazyRational operator*(const LazyRational& lhs, const LazyRational& rhs) {
+		if (!lhs.node_ && !rhs.node_) {
+			double p, e;
+			Arithmetic::two_product(lhs.lo_, rhs.lo_, p, e);
+			if (e == 0 && std::isfinite(p))
+				return p;
+		}
+		if (lhs.is_zero() || rhs.is_zero())
+			return 0.0;
+		if (lhs.is_one())
+			return rhs;
+		if (rhs.is_one())
+			return lhs;
+		double p1 = lhs.lo_ * rhs.lo_, p2 = lhs.lo_ * rhs.hi_, p3 = lhs.hi_ * rhs.lo_, p4 = lhs.hi_ * rhs.hi_;
+		return LazyRational(down(std::fmin(std::fmin(p1, p2), std::fmin(p3, p4))), up(std::fmax(std::fmax(p1, p2), std::fmax(p3, p4))), MUL, lhs, rhs);
+	}
+
+	friend LazyRational operator/(const LazyRational& lhs, const LazyRational& rhs) {
+		if (!lhs.node_ && !rhs.node_ && rhs.lo_ != 0) {
+			double q = lhs.lo_ / rhs.lo_;
+			double p, e;
+			Arithmetic::two_product(q, rhs.lo_, p, e);
+			if (p == lhs.lo_ && e == 0 && std::isfinite(q))
+				return q;
+		}
+		//the quotient is unbounded if the divisor might be zero
+		if (rhs.lo_ <= 0 && rhs.hi_ >= 0)
+			return LazyRational(-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), DIV, lhs, rhs);
+
+		double q1 = lhs.lo_ / rhs.lo_, q2 = lhs.lo_ / rhs.hi_, q3 = lhs.hi_ / rhs.lo_, q4 = lhs.hi_ / rhs.hi_;
+		return LazyRational(down(std::fmin(std::fmin(q1, q2), std::fmin(q3, q4))), up(std::fmax(std::fmax(q1, q2), std::fmax(q3, q4))), DIV, lhs, rhs);
+	}
+
+	LazyRational operator-() const {
+		if (!node_)
+			return -lo_;
+		return LazyRational(-hi_, -lo_, NEG, *this, LazyRational());
+	}
+
+	LazyRational& operator+=(const LazyRational& other) {
+		return *this = *this + other;
+	}
+
+	LazyRational& operator-=(const LazyRational& other) {
+		return *this = *this - other;
+	}
+
+	LazyRational& operator*=(const LazyRational& other) {
+		return *this = *this * other;
+	}
+
+	LazyRational& operator/=(const LazyRational& other) {
+		return *this = *this / other;
+	}
+
+	friend bool operator==(const LazyRational& lhs, const LazyRational& rhs) {
+		return compare(lhs, rhs) == 0;
+	}
+
+	friend bool operator!=(const LazyRational& lhs, const LazyRational& rhs) {
+		return compare(lhs, rhs) != 0;
+	}
+
+	friend bool operator<(const LazyRational& lhs, const LazyRational& rhs) {
+		return compare(lhs, rhs) < 0;
+	}
+
+	friend bool operator>(const LazyRational& lhs, const LazyRational& rhs) {
+		return compare(lhs, rhs) > 0;
+	}
+
+	friend bool operator<=(const LazyRational& lhs, const LazyRational& rhs) {
+		return compare(lhs, rhs) <= 0;
+	}
+
+	friend bool operator>=(const LazyRational& lhs, const LazyRational& rhs) {
+		return compare(lhs, rhs) >= 0;
+	}
+};
+
+/**
+ * @brief The operation that produced a %LazyRational and, once it was needed, its exact value.
+ * Nodes are shared between the copies of a value, and between threads if the value is, so the exact value is published atomically.
+ */
+class LazyRational::Node {
+	Op op_;
+	LazyRational lhs_;
+	LazyRational rhs_;
+	mutable std::atomic<const exact_type*> exact_;
+
+	static exact_type value(const LazyRational& v) {
+		return v.node_ ? v.node_->exact() : exact_type(v.lo_);
+	}
+
+public:
+	Node(Op op, const LazyRational& lhs, const LazyRational& rhs) :
+			op_(op), lhs_(lhs), rhs_(rhs), exact_(nullptr) {
+	}
+
+	explicit Node(const exact_type& e) :
+			op_(LEAF), exact_(new exact_type(e)) {
+	}
+
+	Node(const Node& other) = delete;
+	Node& operator=(const Node& other) = delete;
+
+	~Node() {
+		delete exact_.load();
+	}
+
+	const exact_type& exact() const {
+		const exact_type* e = exact_.load(std::memory_order_acquire);
+		if (e)
+			return *e;
+
+		std::unique_ptr<exact_type> result;
+		switch (op_) {
+		case ADD:
+			result.reset(new exact_type(value(lhs_) + value(rhs_)));
+			break;
+		case SUB:
+			result.reset(new exact_type(value(lhs_) - value(rhs_)));
+			break;
+		case MUL:
+			result.reset(new exact_type(value(lhs_) * value(rhs_)));
+			break;
+		case DIV:
+			result.reset(new exact_type(value(lhs_) / value(rhs_)));
+			break;
+		case NEG:
+			result.reset(new exact_type(-value(lhs_)));
+			break;
+		case LEAF:
+			//leaves are created with their exact value
+			break;
+		}
+
+		//another thread might have been faster, then its value is used
+		const exact_type* expected = nullptr;
+		if (exact_.compare_exchange_strong(expected, result.get(), std::memory_order_acq_rel))
+			return *result.release();
+		return *expected;
+	}
+
+	bool has_exact() const {
+		return exact_.load(std::memory_order_acquire) != nullptr;
+	}
+};
+
+inline LazyRational::LazyRational(const double& lo, const double& hi, Op op, const LazyRational& lhs, const LazyRational& rhs) :
+		lo_(lo), hi_(hi), node_(std::make_shared<const Node>(op, lhs, rhs)) {
+	//cancellations (e.g. x - x) leave an interval around zero that makes every value derived from it undecidable.
+	//so if the interval lost too much precision the exact value is built right away, which is often a double again (e.g. zero).
+	if ((lo_ <= 0 && hi_ >= 0) || hi_ - lo_ > std::fmax(std::fabs(lo_), std::fabs(hi_)) * REFRESH_WIDTH)
+		set_exact(node_->exact());
+}
+
+inline void LazyRational::set_exact(const exact_type& e) {
+	double d = e.convert_to<double>();
+	if (std::isfinite(d) && exact_type(d) == e) {
+		lo_ = hi_ = d;
+		node_.reset();
+	} else {
+		//the conversion rounds to nearest, so the neighbors enclose the value
+		lo_ = down(d);
+		hi_ = up(d);
+		node_ = std::make_shared<const Node>(e);
+	}
+}
+
+inline LazyRational::exact_type LazyRational::exact() const {
+	return node_ ? node_->exact() : exact_type(lo_);
+}
+
+inline long double LazyRational::approx() const {
+	if (!node_)
+		return lo_;
+
+	//narrow intervals are precise enough, e.g. for the bounding boxes of the edge index
+	long double mid = (static_cast<long double>(lo_) + hi_) / 2;
+	if (!node_->has_exact() && (hi_ - lo_) <= std::fabs(mid) * 1e-12L)
+		return mid;
+
+	const exact_type& e = node_->exact();
+	return boost::multiprecision::numerator(e).convert_to<long double>() / boost::multiprecision::denominator(e).convert_to<long double>();
+}
+
+inline int LazyRational::compare(const LazyRational& lhs, const LazyRational& rhs) {
+	if (lhs.hi_ < rhs.lo_)
+		return -1;
+	if (lhs.lo_ > rhs.hi_)
+		return 1;
+	//two doubles that overlap are the same double
+	if (!lhs.node_ && !rhs.node_)
+		return 0;
+
+	//the intervals overlap, so only the exact values can tell
+	if (!rhs.node_)
+		return lhs.node_->exact().compare(rhs.lo_);
+	if (!lhs.node_)
+		return -rhs.node_->exact().compare(lhs.lo_);
+	return lhs.node_->exact().compare(rhs.node_->exact());
+}
+
+inline std::istream& operator>>(std::istream& is, LazyRational& c) {
+	double val;
+	is >> val;
+	c = val;
+	return is;
+}
+}
+
+namespace std {
+inline libnfporb::LazyRational numeric_limits<libnfporb::LazyRational>::min() noexcept {
+	return std::numeric_limits<double>::min();
+}
+
+inline libnfporb::LazyRational numeric_limits<libnfporb::LazyRational>::max() noexcept {
+	return std::numeric_limits<double>::max();
+}
+
+inline libnfporb::LazyRational numeric_limits<libnfporb::LazyRational>::lowest() noexcept {
+	return std::numeric_limits<double>::lowest();
+}
+
+inline libnfporb::LazyRational numeric_limits<libnfporb::LazyRational>::epsilon() noexcept {
+	return 0;
+}
+
+inline libnfporb::LazyRational numeric_limits<libnfporb::LazyRational>::round_error() noexcept {
+	return 0;
+}
+
+inline libnfporb::LazyRational numeric_limits<libnfporb::LazyRational>::infinity() noexcept {
+	return 0;
+}
+
+inline libnfporb::LazyRational numeric_limits<libnfporb::LazyRational>::quiet_NaN() noexcept {
+	return 0;
+}
+
+inline libnfporb::LazyRational numeric_limits<libnfporb::LazyRational>::signaling_NaN() noexcept {
+	return 0;
+}
+
+inline libnfporb::LazyRational numeric_limits<libnfporb::LazyRational>::denorm_min() noexcept {
+	return 0;
+}
+}
+
+namespace boost {
+namespace numeric {
+template<>
+struct raw_converter<boost::numeric::conversion_traits<double, libnfporb::LazyRational>>
+{
+	typedef boost::numeric::conversion_traits<double, libnfporb::LazyRational>::result_type result_type;
+	typedef boost::numeric::conversion_traits<double, libnfporb::LazyRational>::argument_type argument_type;
+
+	static result_type low_level_convert(argument_type s) {
+		return static_cast<double>(s);
+	}
+};
+}
+}
+
+namespace boost { namespace qvm {
+    template <> struct is_scalar<libnfporb::LazyRational> { static bool const value = true; };
+}}
+
+#endif /* SRC_LAZY_RATIONAL_HPP_ */
@@ -12,182 +12,173 @@
 #include "geometry.hpp"
 #include "svg.hpp"
 #include "wkt.hpp"
+#include "grid.hpp"
 #include "translation_vector.hpp"
 #include "history.hpp"
+#include "edge_index.hpp"
+#include "translated_ring.hpp"
+#include "nfp_index.hpp"
+#include "prepared_ring.hpp"
+#include "prepared_polygon.hpp"
+#include "thread_pool.hpp"
 #include "algo/touching_point.hpp"
 #include "algo/trim_vector.hpp"
+#include "algo/kinetic_trim.hpp"
+#include "algo/trim_cache.hpp"
 #include "algo/select_next.hpp"
 #include "algo/find_feasible.hpp"
 #include "algo/search_start.hpp"
+#include "algo/nfp_workspace.hpp"
 #include "algo/slide.hpp"
 
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
 
 /**
- * Delete oscillations and loops from the given ring.
- * @param ring A reference to the ring to be shortened.
- * @return true if the ring has changed.
+ * Count for every distance the pairs of points of a ring that are that far apart and equal (see %equals).
+ * The points are sorted by their epsilon buckets (see %epsilon_bucket), so every point is only compared to the points of the buckets it might equal.
+ * @param ring The ring.
+ * @param len The number of points of the ring to consider.
+ * @param counts Receives the counts, indexed by distance.
  */
-bool delete_consecutive_repeating_point_patterns(polygon_t::ring_type& ring) {
-  size_t startLen = ring.size();
-  off_t len = ring.size();
-  int i, j, counter;
-  for (i = 1; i <= len / 2; ++i) {
-    for (j = i, counter = 0; j < len; ++j) {
-      if (equals(ring[j], ring[j - i]))
-        counter++;
-      else
-        counter = 0;
-      if (counter > 2 && counter == i) {
-        counter = 0;
-        std::copy(ring.begin() + j, ring.begin() + len, ring.begin() + (j - i));
-        j -= i;
-        len -= i;
-      }
-    }
-    ring.resize(j);
-  }
-
-  size_t start = 0, cnt = 0;
-  point_t c, l = ring[0];
-
-  for (size_t i = 1; i < ring.size(); ++i) {
-    c = ring[i];
-    if(equals(c, l)) {
-      if(cnt == 0)
-        start = i - 1;
-
-      ++cnt;
-    } else {
-      if(cnt > 1) {
-        ring.erase(ring.begin() + start + 1, ring.begin() + start + cnt);
-        if(start + cnt >= ring.size())
-          break;
-      }
-    }
-    l = c;
-  }
-  return ring.size() != startLen;
+void count_equal_point_pairs(const polygon_t::ring_type& ring, const size_t& len, std::vector<size_t>& counts) {
+	typedef std::pair<std::pair<int64_t, int64_t>, size_t> entry_t;
+	std::vector<entry_t> entries;
+	entries.reserve(len);
+	for (size_t k = 0; k < len; ++k) {
+		entries.push_back( { { epsilon_bucket(toLongDouble(ring[k].x_)), epsilon_bucket(toLongDouble(ring[k].y_)) }, k });
+	}
+	std::sort(entries.begin(), entries.end());
+
+	counts.assign(len, 0);
+	for (size_t j = 0; j < len; ++j) {
+		auto rx = epsilon_bucket_range(ring[j].x_);
+		auto ry = epsilon_bucket_range(ring[j].y_);
+		for (int64_t bx = rx.first; bx <= rx.second; ++bx) {
+			for (int64_t by = ry.first; by <= ry.second; ++by) {
+				const std::pair<int64_t, int64_t> key(bx, by);
+				//the points of a bucket are sorted by index, only the ones before j are counted
+				for (auto it = std::lower_bound(entries.begin(), entries.end(), entry_t(key, 0)); it != entries.end() && it->first == key && it->second < j; ++it) {
+					if (equals(ring[it->second], ring[j]))
+						++counts[j - it->second];
+				}
+			}
+		}
+	}
 }
 
 /**
- * Remove co-linear points from a ring.
- * @param r A reference to a ring.
+ * Delete oscillations and loops from the given ring.
+ * For every pattern length i >= 3, in ascending order, the ring is scanned once and whenever the last i points equal the i points before them,
+ * the repetition is deleted. A scan can only delete something if at least i points equal the point i before them, so the scan is skipped for all
+ * other lengths. The pairs of equal points are counted up front and again after a scan deleted points.
+ * @param ring A reference to the ring to be shortened.
+ * @return true if the ring has changed.
  */
-void remove_co_linear(polygon_t::ring_type& r) {
-	assert(r.size() > 2);
-	psize_t nextI;
-	psize_t prevI = 0;
-	segment_t segment(r[r.size() - 2], r[0]);
-	polygon_t::ring_type newR;
-
-	for (psize_t i = 1; i < r.size() + 1; ++i) {
-		if (i >= r.size())
-			nextI = i % r.size() + 1;
-		else
-			nextI = i;
-
-		if (get_alignment(segment, r[nextI]) != ON) {
-			newR.push_back(r[prevI]);
+bool delete_consecutive_repeating_point_patterns(polygon_t::ring_type& ring) {
+	size_t startLen = ring.size();
+	size_t len = ring.size();
+	std::vector<size_t> counts;
+	bool counted = false;
+	for (size_t i = 3; i <= len / 2; ++i) {
+		if (!counted) {
+			count_equal_point_pairs(ring, len, counts);
+			counted = true;
+		}
+		if (counts[i] < i)
+			continue;
+
+		//the points are compacted in place: w is the write position, which is the position in the shortened ring
+		size_t w = i;
+		size_t counter = 0;
+		for (size_t r = i; r < len; ++r, ++w) {
+			if (w != r)
+				ring[w] = std::move(ring[r]);
+			if (equals(ring[w], ring[w - i]))
+				++counter;
+			else
+				counter = 0;
+			if (counter == i) {
+				counter = 0;
+				ring[w - i] = std::move(ring[w]);
+				w -= i;
+			}
+		}
+		if (w != len) {
+			len = w;
+			counted = false;
 		}
-		segment = {segment.second, r[nextI]};
-		prevI = nextI;
 	}
-
-	r = newR;
+	ring.resize(len);
+
+	size_t start = 0, cnt = 0;
+	point_t c, l = ring[0];
+
+	for (size_t i = 1; i < ring.size(); ++i) {
+		c = ring[i];
+		if(equals(c, l)) {
+			if(cnt == 0)
+				start = i - 1;
+
+			++cnt;
+		} else {
+			if(cnt > 1) {
+				ring.erase(ring.begin() + start + 1, ring.begin() + start + cnt);
+				if(start + cnt >= ring.size())
+					break;
+			}
+		}
+		l = c;
+	}
+	return ring.size() != startLen;
 }
+
 /**
- * Remove co-linear points from a polygon.
- * @param p A reference to a polygon.
+ * Throw if one of the prepared polygons was checked and found invalid.
+ * @param pA polygon A (the stationary polygon).
+ * @param pB polygon B (the orbiting polygon).
  */
-void remove_co_linear(polygon_t& p) {
-	remove_co_linear(p.outer());
-	for (auto& r : p.inners())
-		remove_co_linear(r);
+void check_validity(const PreparedPolygon& pA, const PreparedPolygon& pB) {
+	if (!pA.valid())
+		throw std::runtime_error("Polygon A is invalid: " + pA.reason());
 
-	bg::correct(p);
+	if (!pB.valid())
+		throw std::runtime_error("Polygon B is invalid: " + pB.reason());
 }
 
 /**
- * Generate the NFP for the given polygons pA and pB. Optionally check the input polygons for validity.
+ * Choose the frame the NFP is computed in. By default A and B are moved by the same translation, which brings them into the positive quadrant.
+ * The double and the grid backend work in local coordinates instead: A and B are each moved to the origin, which keeps the magnitudes
+ * of the coordinates and with them the rounding errors small, and keeps points on the grid on it. The translation of B doesn't change the NFP, which follows A.
  * @param pA polygon A (the stationary polygon).
  * @param pB polygon B (the orbiting polygon).
- *  * @param checkValidity Check the input polygons for validity if true. Defaults to true.
- * @return The generated NFP.
+ * @param transA The translation of A is written to this reference.
+ * @param transB The translation of B is written to this reference.
  */
-nfp_t generate_nfp(polygon_t& pA, polygon_t& pB, const bool checkValidity = true) {
-	remove_co_linear(pA);
-	remove_co_linear(pB);
-
-	if (checkValidity) {
-		std::string reason;
-		if (!bg::is_valid(pA, reason))
-			throw std::runtime_error("Polygon A is invalid: " + reason);
-
-		if (!bg::is_valid(pB, reason))
-			throw std::runtime_error("Polygon B is invalid: " + reason);
-	}
-
-	nfp_t nfp;
-
-#ifdef NFP_DEBUG
-	write_svg("start.svg", {pA, pB});
+void frame_translations(const PreparedPolygon& pA, const PreparedPolygon& pB, point_t& transA, point_t& transB) {
+#if defined(LIBNFP_USE_DOUBLE) || defined(LIBNFP_USE_GRID)
+	transA = pA.local_translation();
+	transB = pB.local_translation();
+#else
+	transA = pA.quadrant_translation() + pB.quadrant_translation();
+	transB = transA;
 #endif
+}
 
-	DEBUG_VAL(bg::wkt(pA));
-	DEBUG_VAL(bg::wkt(pB));
-
-
-	polygon_t pAtrans;
-	polygon_t pBtrans;
-
-	std::vector<psize_t> yAminI = find_minimum_y(pA);
-	std::vector<psize_t> yBminI = find_minimum_y(pB);
-	std::vector<psize_t> xAminI = find_minimum_x(pA);
-	std::vector<psize_t> xBminI = find_minimum_x(pB);
-	std::vector<psize_t> yAmaxI = find_maximum_y(pA);
-	std::vector<psize_t> yBmaxI = find_maximum_y(pB);
-	std::vector<psize_t> xAmaxI = find_maximum_x(pA);
-	std::vector<psize_t> xBmaxI = find_maximum_x(pB);
-
-	point_t preTrans;
-	LongDouble leftA = pA.outer()[xAminI.front()].x_;
-	LongDouble rightA = pA.outer()[xAmaxI.front()].x_;
-	if(rightA < 0) {
-		preTrans.x_ = rightA * -1;
-	} else if(leftA < 0) {
-		preTrans.x_ = leftA * -1;
-	}
-
-	LongDouble topA = pA.outer()[yAmaxI.front()].y_;
-	LongDouble bottomA = pA.outer()[yAminI.front()].y_;
-	if(topA < 0) {
-		preTrans.y_ = topA * -1;
-	} else if(bottomA < 0) {
-		preTrans.y_ = bottomA * -1;
-	}
-
-	LongDouble leftB = pB.outer()[xBminI.front()].x_;
-	LongDouble rightB = pB.outer()[xBmaxI.front()].x_;
-	if(rightB < 0) {
-		preTrans.x_ += rightB * -1;
-	} else if(leftB < 0) {
-		preTrans.x_ += leftB * -1;
-	}
-
-	LongDouble topB = pB.outer()[yBmaxI.front()].y_;
-	LongDouble bottomB = pB.outer()[yBminI.front()].y_;
-	if(topB < 0) {
-		preTrans.y_ += topB * -1;
-	} else if(bottomB < 0) {
-		preTrans.y_ += bottomB * -1;
-	}
+/**
+ * Perform the orbiting of B around A. Both polygons have to be translated into the frame of the computation already (see %frame_translations).
+ * @param pA polygon A (the stationary polygon).
+ * @param pB polygon B (the orbiting polygon). Only its extremal points are used.
+ * @param rB The outer ring of pB, translated into the frame of the computation. Is left at the position the last slide ended.
+ * @param workspace The buffers of the slides.
+ * @param pool If not null the search for start positions is parallelized on this pool.
+ * @return The generated NFP, not yet cleaned up.
+ */
+nfp_t orbit(const PreparedPolygon& pA, const PreparedPolygon& pB, polygon_t::ring_type& rB, NfpWorkspace& workspace, ThreadPool* pool) {
+	nfp_t nfp;
 
-	trans::translate_transformer<coord_t, 2, 2> transformer(preTrans.x_, preTrans.y_);
-	boost::geometry::transform(pA, pAtrans, transformer);
-	boost::geometry::transform(pB, pBtrans, transformer);
-	pA = std::move(pAtrans);
-	pB = std::move(pBtrans);
+	const std::vector<psize_t>& yAminI = pA.minimum_y();
+	const std::vector<psize_t>& yBmaxI = pB.maximum_y();
 
 	point_t pAstart;
 	point_t pBstart;
@@ -196,7 +187,7 @@ nfp_t generate_nfp(polygon_t& pA, polygon_t& pB, const bool checkValidity = true
 		//find right-most of A and left-most of B to prevent double connection at start
 		coord_t maxX = MIN_COORD;
 		psize_t iRightMost = 0;
-		for (psize_t& ia : yAminI) {
+		for (const psize_t& ia : yAminI) {
 			const point_t& candidateA = pA.outer()[ia];
 			if (larger(candidateA.x_, maxX)) {
 				maxX = candidateA.x_;
@@ -206,60 +197,61 @@ nfp_t generate_nfp(polygon_t& pA, polygon_t& pB, const bool checkValidity = true
 
 		coord_t minX = MAX_COORD;
 		psize_t iLeftMost = 0;
-		for (psize_t& ib : yBmaxI) {
-			const point_t& candidateB = pB.outer()[ib];
+		for (const psize_t& ib : yBmaxI) {
+			const point_t& candidateB = rB[ib];
 			if (smaller(candidateB.x_, minX)) {
 				minX = candidateB.x_;
 				iLeftMost = ib;
 			}
 		}
 		pAstart = pA.outer()[iRightMost];
-		pBstart = pB.outer()[iLeftMost];
+		pBstart = rB[iLeftMost];
 	} else {
 		pAstart = pA.outer()[yAminI.front()];
-		pBstart = pB.outer()[yBmaxI.front()];
+		pBstart = rB[yBmaxI.front()];
 	}
 
 	nfp.push_back( { });
+	NfpIndex nfpIndex;
+	//which vertices of the rings of A were already visited by a slide or tried by the start search
+	std::vector<bool> visitedOuter(pA.outer().size(), false);
 	point_t transB = { pAstart - pBstart };
 
 
 
 	SlideResult res;
-	if ((res = slide(pA, pA.outer(), pB.outer(), nfp, transB, false))!= LOOP) {
+	if ((res = slide(pA.polygon(), pA.prepared_outer(), visitedOuter, rB, nfp, nfpIndex, transB, false, workspace))!= LOOP) {
 		throw std::runtime_error("Unable to complete outer nfp loop: " + std::to_string(res));
 	}
 
 	DEBUG_VAL("##### outer #####");
 	point_t startTrans;
 	while (true) {
-		SearchStartResult res = search_start_translation(pA.outer(), pB.outer(), nfp, false, startTrans);
+		SearchStartResult res = search_start_translation(pA.outer(), pA.prepared_outer(), visitedOuter, rB, nfp, nfpIndex, false, startTrans, pool);
 		if (res == FOUND) {
 			nfp.push_back( { });
 			DEBUG_VAL("##### interlock start #####");
-			polygon_t::ring_type rifsB;
-			boost::geometry::transform(pB.outer(), rifsB, trans::translate_transformer<coord_t, 2, 2>(startTrans.x_, startTrans.y_));
-			if (in_nfp(rifsB.front(), nfp)) {
+			if (in_nfp(TranslatedRing(rB, startTrans).front(), nfp, nfpIndex)) {
 				continue;
 			}
-			SlideResult sres = slide(pA, pA.outer(), pB.outer(), nfp, startTrans, true);
+			SlideResult sres = slide(pA.polygon(), pA.prepared_outer(), visitedOuter, rB, nfp, nfpIndex, startTrans, true, workspace);
 			if (sres != LOOP) {
 				if (sres == NO_TRANSLATION) {
 					//no initial slide found -> jigsaw
-					if (!in_nfp(pB.outer().front(), nfp)) {
+					if (!in_nfp(rB.front(), nfp, nfpIndex)) {
 						nfp.push_back( { });
-						nfp.back().push_back(pB.outer().front());
+						nfp.back().push_back(rB.front());
 					}
 				}
 			}
 			DEBUG_VAL("##### interlock end #####");
 		} else if (res == FIT) {
 			DEBUG_VAL("##### perfect fit #####");
-			point_t reference = pB.outer().front();
+			point_t reference = rB.front();
 			point_t translated;
 			trans::translate_transformer<coord_t, 2, 2> translate(startTrans.x_, startTrans.y_);
 			boost::geometry::transform(reference, translated, translate);
-			if (!in_nfp(translated, nfp)) {
+			if (!in_nfp(translated, nfp, nfpIndex)) {
 				nfp.push_back( { });
 				nfp.back().push_back(translated);
 			}
@@ -268,20 +260,23 @@ nfp_t generate_nfp(polygon_t& pA, polygon_t& pB, const bool checkValidity = true
 			break;
 	}
 
-	for (auto& rA : pA.inners()) {
+	for (psize_t i = 0; i < pA.num_inners(); ++i) {
+		const PreparedRing& preparedHole = pA.prepared_inner(i);
+		const polygon_t::ring_type& rA = preparedHole.ring();
+		std::vector<bool> visitedHole(rA.size(), false);
 		while (true) {
-			SearchStartResult res = search_start_translation(rA, pB.outer(), nfp, true, startTrans);
+			SearchStartResult res = search_start_translation(rA, preparedHole, visitedHole, rB, nfp, nfpIndex, true, startTrans, pool);
 			if (res == FOUND) {
 				nfp.push_back( { });
 				DEBUG_VAL("##### hole start #####");
-				slide(pA, rA, pB.outer(), nfp, startTrans, true);
+				slide(pA.polygon(), preparedHole, visitedHole, rB, nfp, nfpIndex, startTrans, true, workspace);
 				DEBUG_VAL("##### hole end #####");
 			} else if (res == FIT) {
-				point_t reference = pB.outer().front();
+				point_t reference = rB.front();
 				point_t translated;
 				trans::translate_transformer<coord_t, 2, 2> translate(startTrans.x_, startTrans.y_);
 				boost::geometry::transform(reference, translated, translate);
-				if (!in_nfp(translated, nfp)) {
+				if (!in_nfp(translated, nfp, nfpIndex)) {
 					nfp.push_back( { });
 					nfp.back().push_back(translated);
 				}
@@ -291,10 +286,15 @@ nfp_t generate_nfp(polygon_t& pA, polygon_t& pB, const bool checkValidity = true
 		}
 	}
 
-#ifdef NFP_DEBUG
-	write_svg("nfp.svg", pA,pB, nfp);
-#endif
+	return nfp;
+}
 
+/**
+ * Delete oscillations and loops from the rings of the NFP, correct them and translate them back from the frame of the computation.
+ * @param nfp The NFP as generated by %orbit.
+ * @param preTrans The translation that moved A into the frame of the computation.
+ */
+void finish_nfp(nfp_t& nfp, const point_t& preTrans) {
 	trans::translate_transformer<coord_t, 2, 2> transformerBack(-preTrans.x_, -preTrans.y_);
 
 	polygon_t::ring_type translatedBack;
@@ -304,8 +304,170 @@ nfp_t generate_nfp(polygon_t& pA, polygon_t& pB, const bool checkValidity = true
 		boost::geometry::transform(r, translatedBack, transformerBack);
 		r = std::move(translatedBack);
 	}
+}
 
+/**
+ * Generate the NFP for the given prepared polygons. Validity was checked on preparation, if at all.
+ * Nothing is copied but the outer ring of B, unless the polygons have to be translated into the positive quadrant.
+ * Polygons that lie in the positive quadrant already are used as they are. All state of the computation but the workspace is local to the call,
+ * so the same prepared polygons may be shared by concurrent calls with different workspaces.
+ * @param pA prepared polygon A (the stationary polygon).
+ * @param pB prepared polygon B (the orbiting polygon).
+ * @param workspace The buffers of the slides. Reusing it for many calls saves allocating them anew. Its %NfpWorkspace::trimEngine_ selects how the slides trim.
+ * @param pool If not null the search for start positions is parallelized on this pool. The result is the same.
+ * @throws runtime_error if one of the polygons is invalid
+ * @return The generated NFP.
+ */
+nfp_t generate_nfp(const PreparedPolygon& pA, const PreparedPolygon& pB, NfpWorkspace& workspace, ThreadPool* pool = nullptr) {
+	check_validity(pA, pB);
+
+	DEBUG_VAL(bg::wkt(pA.polygon()));
+	DEBUG_VAL(bg::wkt(pB.polygon()));
+
+	point_t transA;
+	point_t transB;
+	frame_translations(pA, pB, transA, transB);
+	trans::translate_transformer<coord_t, 2, 2> transformer(transB.x_, transB.y_);
+	polygon_t::ring_type rB;
+	boost::geometry::transform(pB.outer(), rB, transformer);
+
+	nfp_t nfp;
+	if (transA.x_ == 0 && transA.y_ == 0)
+		nfp = orbit(pA, pB, rB, workspace, pool);
+	else
+		nfp = orbit(pA.translated(transA), pB, rB, workspace, pool);
+
+	finish_nfp(nfp, transA);
 	return nfp;
 }
+
+/**
+ * Generate the NFP for the given prepared polygons with the workspace of the calling thread (see %NfpWorkspace::local).
+ * The same prepared polygons may be shared by concurrent calls.
+ * @param pA prepared polygon A (the stationary polygon).
+ * @param pB prepared polygon B (the orbiting polygon).
+ * @param pool If not null the search for start positions is parallelized on this pool. The result is the same.
+ * @throws runtime_error if one of the polygons is invalid
+ * @return The generated NFP.
+ */
+nfp_t generate_nfp(const PreparedPolygon& pA, const PreparedPolygon& pB, ThreadPool* pool = nullptr) {
+	return generate_nfp(pA, pB, NfpWorkspace::local(), pool);
+}
+
+/**
+ * Generate the NFP for the given polygons pA and pB. Optionally check the input polygons for validity.
+ * Works on the given polygons: pA is cleaned and translated into the frame of the computation (see %frame_translations), pB is left at the position the last slide ended.
+ * Use the overload for const polygons if the input must not change.
+ * @param pA polygon A (the stationary polygon).
+ * @param pB polygon B (the orbiting polygon).
+ *  * @param checkValidity Check the input polygons for validity if true. Defaults to true.
+ * @param pool If not null the search for start positions is parallelized on this pool. The result is the same.
+ * @return The generated NFP.
+ */
+nfp_t generate_nfp(polygon_t& pA, polygon_t& pB, const bool checkValidity = true, ThreadPool* pool = nullptr) {
+	PreparedPolygon preparedA(pA, checkValidity);
+	PreparedPolygon preparedB(pB, checkValidity);
+	check_validity(preparedA, preparedB);
+
+#ifdef NFP_DEBUG
+	write_svg("start.svg", {preparedA.polygon(), preparedB.polygon()});
+#endif
+
+	DEBUG_VAL(bg::wkt(preparedA.polygon()));
+	DEBUG_VAL(bg::wkt(preparedB.polygon()));
+
+	point_t transA;
+	point_t transB;
+	frame_translations(preparedA, preparedB, transA, transB);
+	trans::translate_transformer<coord_t, 2, 2> transformer(transB.x_, transB.y_);
+	PreparedPolygon translatedA = preparedA.translated(transA);
+	polygon_t translatedB;
+	boost::geometry::transform(preparedB.polygon(), translatedB, transformer);
+
+	nfp_t nfp = orbit(translatedA, preparedB, translatedB.outer(), NfpWorkspace::local(), pool);
+
+	pA = translatedA.polygon();
+	pB = std::move(translatedB);
+
+#ifdef NFP_DEBUG
+	write_svg("nfp.svg", pA,pB, nfp);
+#endif
+
+	finish_nfp(nfp, transA);
+	return nfp;
+}
+
+/**
+ * Generate the NFP for the given polygons pA and pB without modifying them. Optionally check the input polygons for validity.
+ * The slides use the workspace of the calling thread, so the same polygons may be shared by concurrent calls.
+ * To use a polygon in many computations prepare it once and use the overload for %PreparedPolygon.
+ * @param pA polygon A (the stationary polygon).
+ * @param pB polygon B (the orbiting polygon).
+ * @param checkValidity Check the input polygons for validity if true. Defaults to true.
+ * @param pool If not null the search for start positions is parallelized on this pool. The result is the same.
+ * @return The generated NFP.
+ */
+nfp_t generate_nfp(const polygon_t& pA, const polygon_t& pB, const bool checkValidity = true, ThreadPool* pool = nullptr) {
+	return generate_nfp(PreparedPolygon(pA, checkValidity), PreparedPolygon(pB, checkValidity), pool);
+}
+
+/**
+ * The result of one pair of a batch generated by %generate_nfps.
+ */
+struct NfpResult {
+	nfp_t nfp_;
+	bool success_ = false;
+	std::string error_;
+};
+
+/**
+ * Generate the NFPs for a batch of polygon pairs in parallel. The pairs are started in order of their estimated cost (the product of their point counts),
+ * most expensive first, and are balanced by work stealing. Errors don't abort the batch but are reported per pair.
+ * @param pairs The pairs of polygon A (the stationary polygon) and polygon B (the orbiting polygon). They aren't modified.
+ * @param pool The pool to run on. The search for start positions of every pair is parallelized on it as well.
+ * @param checkValidity Check the input polygons for validity if true. Defaults to true.
+ * @return The results in the order of the input pairs.
+ */
+std::vector<NfpResult> generate_nfps(const std::vector<std::pair<polygon_t, polygon_t>>& pairs, ThreadPool& pool, const bool checkValidity = true) {
+	std::vector<NfpResult> results(pairs.size());
+	std::vector<size_t> cost(pairs.size());
+	std::vector<size_t> order(pairs.size());
+
+	for (size_t i = 0; i < pairs.size(); ++i) {
+		cost[i] = bg::num_points(pairs[i].first) * bg::num_points(pairs[i].second);
+		order[i] = i;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&](const size_t& lhs, const size_t& rhs) {
+		return cost[lhs] > cost[rhs];
+	});
+
+	pool.parallel_for_stealing(order, [&](const size_t& i) {
+		NfpResult& result = results[i];
+		try {
+			result.nfp_ = generate_nfp(pairs[i].first, pairs[i].second, checkValidity, &pool);
+			result.success_ = true;
+		} catch (std::exception& ex) {
+			result.error_ = ex.what();
+		} catch (...) {
+			result.error_ = "Unknown error";
+		}
+	});
+
+	return results;
+}
+
+/**
+ * Generate the NFPs for a batch of polygon pairs in parallel on a pool that is created for this batch.
+ * @param pairs The pairs of polygon A (the stationary polygon) and polygon B (the orbiting polygon).
+ * @param checkValidity Check the input polygons for validity if true. Defaults to true.
+ * @param threads The number of worker threads. Defaults to the number of hardware threads.
+ * @return The results in the order of the input pairs.
+ */
+std::vector<NfpResult> generate_nfps(const std::vector<std::pair<polygon_t, polygon_t>>& pairs, const bool checkValidity = true, const size_t& threads = std::thread::hardware_concurrency()) {
+	ThreadPool pool(threads);
+	return generate_nfps(pairs, pool, checkValidity);
+}
+}
 }
 #endif
@@ -0,0 +1,102 @@
+#ifndef SRC_NFP_INDEX_HPP_
+#define SRC_NFP_INDEX_HPP_
+
+#include <vector>
+
+#include "geometry.hpp"
+#include "edge_index.hpp"
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+/**
+ * @brief A spatial index (rtree) over the segments of a growing NFP.
+ * The NFP is only ever appended to while it is generated, so the index keeps track of how many points of every ring
+ * are already indexed and only inserts the new segments on %update.
+ * Point queries mirror bg::touches(point, ring) by applying the same winding strategy to the candidate segments only.
+ */
+class NfpIndex {
+public:
+	//ring index and segment index. segment i is the segment from ring[i] to ring[i + 1].
+	typedef std::pair<psize_t, psize_t> segment_id_t;
+	typedef std::pair<boxf_t, segment_id_t> value_t;
+private:
+	//the tree is filled by insertion, which is cheaper with the quadratic than with the r* algorithm
+	bgi::rtree<value_t, bgi::quadratic<16>> tree_;
+	std::vector<psize_t> indexed_;
+
+	/**
+	 * @brief Check if the point touches the given segment of a ring, exactly like bg::touches(point, ring) would.
+	 * bg::touches iterates over the normalized (= clockwise) view of the ring, so the segment is passed in reverse order.
+	 */
+	static bool touches_segment(const point_t& pt, const polygon_t::ring_type& ring, const psize_t& i) {
+		typedef bg::strategy::within::cartesian_winding<point_t, point_t> strategy_t;
+		strategy_t::state_type state;
+		return !strategy_t::apply(pt, ring[i + 1], ring[i], state);
+	}
+public:
+	/**
+	 * @brief Insert all segments that were appended to the NFP since the last update.
+	 * @param nfp The NFP. Rings and points may only have been appended since the last update.
+	 */
+	void update(const nfp_t& nfp) {
+		if (indexed_.size() < nfp.size())
+			indexed_.resize(nfp.size(), 0);
+
+		for (psize_t r = 0; r < nfp.size(); ++r) {
+			const auto& ring = nfp[r];
+			psize_t& indexed = indexed_[r];
+			if (indexed == ring.size())
+				continue;
+
+			for (psize_t i = (indexed > 0 ? indexed - 1 : 0); i + 1 < ring.size(); ++i) {
+				tree_.insert( { make_box(ring[i], ring[i + 1]), { r, i } });
+			}
+			indexed = ring.size();
+		}
+	}
+
+	/**
+	 * @brief Check if a point touches one of the rings of the NFP. The index has to be up to date.
+	 * @param pt The point.
+	 * @param nfp The NFP.
+	 * @param ring Only check the ring with this index. Checks all rings if it is negative.
+	 * @return true if the point touches the ring(s) (see bg::touches).
+	 */
+	bool touches(const point_t& pt, const nfp_t& nfp, const off_t& ring = -1) const {
+		//a query iterator allocates its traversal stack, the callback query doesn't
+		bool found = false;
+		tree_.query(bgi::intersects(make_box(pt, pt)), boost::make_function_output_iterator([&](const value_t& v) {
+			const segment_id_t& id = v.second;
+			if (found || (ring >= 0 && id.first != psize_t(ring)))
+				return;
+
+			const auto& r = nfp[id.first];
+			//bg::touches considers rings with less points invalid
+			if (r.size() < bg::core_detail::closure::minimum_ring_size<bg::closure<polygon_t::ring_type>::value>::value)
+				return;
+
+			found = touches_segment(pt, r, id.second);
+		}));
+		return found;
+	}
+
+	size_t size() const {
+		return tree_.size();
+	}
+};
+
+/**
+ * @brief Check if a point is part of the NFP using a %NfpIndex. Updates the index if the NFP was appended to.
+ * @param pt The point.
+ * @param nfp The NFP.
+ * @param index The index of the NFP.
+ * @return true if the point touches any ring of the NFP.
+ */
+bool in_nfp(const point_t& pt, const nfp_t& nfp, NfpIndex& index) {
+	index.update(nfp);
+	return index.touches(pt, nfp);
+}
+}
+}
+
+#endif /* SRC_NFP_INDEX_HPP_ */
@@ -0,0 +1,268 @@
+#ifndef SRC_PREDICATES_HPP_
+#define SRC_PREDICATES_HPP_
+
+#include <cmath>
+#include <limits>
+
+namespace libnfporb {
+namespace predicates {
+/**
+ * Adaptive precision orientation predicate after Shewchuk, "Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric Predicates".
+ * The determinant is evaluated in floating point first. Only if its error bound doesn't decide the sign it is evaluated again,
+ * exactly, as a floating point expansion. Works for any binary floating point type T that rounds to nearest,
+ * which excludes builds with -Ofast/-ffast-math and fused multiply-adds (see the Makefile).
+ * These functions don't depend on the coordinate backend, so they are not part of its inline namespace.
+ */
+template<typename T>
+struct Arithmetic {
+	//half an ulp of 1
+	static constexpr T epsilon = std::numeric_limits<T>::epsilon() / 2;
+	//2^ceil(digits / 2) + 1, used to split a number into two halves of half the precision
+	static constexpr T splitter = static_cast<T>(1ULL << ((std::numeric_limits<T>::digits + 1) / 2)) + 1;
+	static constexpr T errboundA = (3 + 16 * epsilon) * epsilon;
+
+	static inline void two_sum(const T& a, const T& b, T& x, T& y) {
+		x = a + b;
+		T bvirt = x - a;
+		T avirt = x - bvirt;
+		y = (a - avirt) + (b - bvirt);
+	}
+
+	static inline void two_diff(const T& a, const T& b, T& x, T& y) {
+		x = a - b;
+		y = two_diff_tail(a, b, x);
+	}
+
+	static inline T two_diff_tail(const T& a, const T& b, const T& x) {
+		T bvirt = a - x;
+		T avirt = x + bvirt;
+		return (a - avirt) + (bvirt - b);
+	}
+
+	static inline void split(const T& a, T& hi, T& lo) {
+		T c = splitter * a;
+		T abig = c - a;
+		hi = c - abig;
+		lo = a - hi;
+	}
+
+	static inline void two_product(const T& a, const T& b, T& x, T& y) {
+		x = a * b;
+		T ahi, alo, bhi, blo;
+		split(a, ahi, alo);
+		split(b, bhi, blo);
+		T err1 = x - (ahi * bhi);
+		T err2 = err1 - (alo * bhi);
+		T err3 = err2 - (ahi * blo);
+		y = (alo * blo) - err3;
+	}
+
+	/**
+	 * The exact difference a1 * b1 - a0 * b0 as an expansion of four components in increasing magnitude.
+	 */
+	static inline void two_product_diff(const T& a1, const T& b1, const T& a0, const T& b0, T* h) {
+		T x1, x0, y1, y0;
+		two_product(a1, b1, x1, x0);
+		two_product(a0, b0, y1, y0);
+		T i, j, k, l;
+		two_diff(x0, y0, i, h[0]);
+		two_sum(x1, i, j, k);
+		two_diff(k, y1, i, h[1]);
+		two_sum(j, i, l, h[2]);
+		h[3] = l;
+	}
+
+	//unlike Shewchuk's code the merge never reads past the end of an expansion
+	static inline T component(const int& len, const T* e, const int& i) {
+		return i < len ? e[i] : 0;
+	}
+
+	/**
+	 * Sum two nonoverlapping expansions, dropping zero components (fast_expansion_sum_zeroelim).
+	 * @return The length of the resulting expansion h, which has room for elen + flen components.
+	 */
+	static int expansion_sum(const int& elen, const T* e, const int& flen, const T* f, T* h) {
+		T q, qnew, hh;
+		int eindex = 0, findex = 0, hindex = 0;
+		T enow = e[0];
+		T fnow = f[0];
+		if ((fnow > enow) == (fnow > -enow)) {
+			q = enow;
+			enow = component(elen, e, ++eindex);
+		} else {
+			q = fnow;
+			fnow = component(flen, f, ++findex);
+		}
+		if ((eindex < elen) && (findex < flen)) {
+			if ((fnow > enow) == (fnow > -enow)) {
+				fast_two_sum(enow, q, qnew, hh);
+				enow = component(elen, e, ++eindex);
+			} else {
+				fast_two_sum(fnow, q, qnew, hh);
+				fnow = component(flen, f, ++findex);
+			}
+			q = qnew;
+			if (hh != 0)
+				h[hindex++] = hh;
+			while ((eindex < elen) && (findex < flen)) {
+				if ((fnow > enow) == (fnow > -enow)) {
+					two_sum(q, enow, qnew, hh);
+					enow = component(elen, e, ++eindex);
+				} else {
+					two_sum(q, fnow, qnew, hh);
+					fnow = component(flen, f, ++findex);
+				}
+				q = qnew;
+				if (hh != 0)
+					h[hindex++] = hh;
+			}
+		}
+		while (eindex < elen) {
+			two_sum(q, enow, qnew, hh);
+			enow = component(elen, e, ++eindex);
+			q = qnew;
+			if (hh != 0)
+				h[hindex++] = hh;
+		}
+		while (findex < flen) {
+			two_sum(q, fnow, qnew, hh);
+			fnow = component(flen, f, ++findex);
+			q = qnew;
+			if (hh != 0)
+				h[hindex++] = hh;
+		}
+		if ((q != 0) || (hindex == 0))
+			h[hindex++] = q;
+		return hindex;
+	}
+
+	/**
+	 * Multiply an expansion by a number, dropping zero components (scale_expansion_zeroelim).
+	 * @return The length of the resulting expansion h, which has room for 2 * elen components.
+	 */
+	static int scale_expansion(const int& elen, const T* e, const T& b, T* h) {
+		T q, sum, hh, product1, product0;
+		int hindex = 0;
+		two_product(e[0], b, q, hh);
+		if (hh != 0)
+			h[hindex++] = hh;
+		for (int eindex = 1; eindex < elen; eindex++) {
+			two_product(e[eindex], b, product1, product0);
+			two_sum(q, product0, sum, hh);
+			if (hh != 0)
+				h[hindex++] = hh;
+			fast_two_sum(product1, sum, q, hh);
+			if (hh != 0)
+				h[hindex++] = hh;
+		}
+		if ((q != 0) || (hindex == 0))
+			h[hindex++] = q;
+		return hindex;
+	}
+
+	static inline void fast_two_sum(const T& a, const T& b, T& x, T& y) {
+		x = a + b;
+		T bvirt = x - a;
+		y = b - bvirt;
+	}
+
+	/**
+	 * @return The sign of an expansion, which is the sign of its largest component.
+	 */
+	static inline int sign(const int& len, const T* e) {
+		for (int i = len - 1; i >= 0; --i) {
+			if (e[i] > 0)
+				return 1;
+			else if (e[i] < 0)
+				return -1;
+		}
+		return 0;
+	}
+
+	/**
+	 * Evaluate the determinant exactly, including the round-off of the differences.
+	 */
+	static int orient2d_exact(const T& ax, const T& ay, const T& bx, const T& by, const T& cx, const T& cy) {
+		T acx[2], acy[2], bcx[2], bcy[2];
+		two_diff(ax, cx, acx[1], acx[0]);
+		two_diff(ay, cy, acy[1], acy[0]);
+		two_diff(bx, cx, bcx[1], bcx[0]);
+		two_diff(by, cy, bcy[1], bcy[0]);
+
+		//(acx * bcy) and (acy * bcx) as sums of two scaled expansions each
+		T t1[4], t2[4], left[8], right[8], det[16];
+		int l1 = scale_expansion(2, acx, bcy[0], t1);
+		int l2 = scale_expansion(2, acx, bcy[1], t2);
+		int leftLen = expansion_sum(l1, t1, l2, t2, left);
+
+		l1 = scale_expansion(2, acy, -bcx[0], t1);
+		l2 = scale_expansion(2, acy, -bcx[1], t2);
+		int rightLen = expansion_sum(l1, t1, l2, t2, right);
+
+		int detLen = expansion_sum(leftLen, left, rightLen, right, det);
+		return sign(detLen, det);
+	}
+
+	/**
+	 * @return 1 if a, b and c are in counterclockwise order, -1 if they are in clockwise order and 0 if they are collinear.
+	 */
+	static int orient2d(const T& ax, const T& ay, const T& bx, const T& by, const T& cx, const T& cy) {
+		T detleft = (ax - cx) * (by - cy);
+		T detright = (ay - cy) * (bx - cx);
+		T det = detleft - detright;
+		T detsum;
+
+		if (detleft > 0) {
+			if (detright <= 0)
+				return det > 0 ? 1 : (det < 0 ? -1 : 0);
+			detsum = detleft + detright;
+		} else if (detleft < 0) {
+			if (detright >= 0)
+				return det > 0 ? 1 : (det < 0 ? -1 : 0);
+			detsum = -detleft - detright;
+		} else {
+			return det > 0 ? 1 : (det < 0 ? -1 : 0);
+		}
+
+		T errbound = errboundA * detsum;
+		if (det >= errbound)
+			return 1;
+		if (-det >= errbound)
+			return -1;
+
+		//the differences are usually exact. then the products and their difference are computed exactly in a 4 component expansion.
+		T acx, acy, bcx, bcy;
+		T acxtail, acytail, bcxtail, bcytail;
+		two_diff(ax, cx, acx, acxtail);
+		two_diff(ay, cy, acy, acytail);
+		two_diff(bx, cx, bcx, bcxtail);
+		two_diff(by, cy, bcy, bcytail);
+
+		if (acxtail == 0 && acytail == 0 && bcxtail == 0 && bcytail == 0) {
+			T B[4];
+			two_product_diff(acx, bcy, acy, bcx, B);
+			return sign(4, B);
+		}
+
+		return orient2d_exact(ax, ay, bx, by, cx, cy);
+	}
+};
+
+template<typename T>
+constexpr T Arithmetic<T>::epsilon;
+template<typename T>
+constexpr T Arithmetic<T>::splitter;
+template<typename T>
+constexpr T Arithmetic<T>::errboundA;
+
+/**
+ * @return 1 if a, b and c are in counterclockwise order, -1 if they are in clockwise order and 0 if they are collinear.
+ */
+template<typename T>
+inline int orient2d(const T& ax, const T& ay, const T& bx, const T& by, const T& cx, const T& cy) {
+	return Arithmetic<T>::orient2d(ax, ay, bx, by, cx, cy);
+}
+}
+}
+
+#endif /* SRC_PREDICATES_HPP_ */
@@ -0,0 +1,223 @@
+#ifndef SRC_PREPARED_POLYGON_HPP_
+#define SRC_PREPARED_POLYGON_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "geometry.hpp"
+#include "prepared_ring.hpp"
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+
+/**
+ * Remove co-linear points from a ring.
+ * @param r A reference to a ring.
+ */
+void remove_co_linear(polygon_t::ring_type& r) {
+	assert(r.size() > 2);
+	psize_t nextI;
+	psize_t prevI = 0;
+	segment_t segment(r[r.size() - 2], r[0]);
+	polygon_t::ring_type newR;
+
+	for (psize_t i = 1; i < r.size() + 1; ++i) {
+		if (i >= r.size())
+			nextI = i % r.size() + 1;
+		else
+			nextI = i;
+
+		if (get_alignment(segment, r[nextI]) != ON) {
+			newR.push_back(r[prevI]);
+		}
+		segment = {segment.second, r[nextI]};
+		prevI = nextI;
+	}
+
+	r = newR;
+}
+/**
+ * Remove co-linear points from a polygon.
+ * @param p A reference to a polygon.
+ */
+void remove_co_linear(polygon_t& p) {
+	remove_co_linear(p.outer());
+	for (auto& r : p.inners())
+		remove_co_linear(r);
+
+	bg::correct(p);
+}
+
+/**
+ * @brief A polygon prepared once for any number of NFP computations: the cleaned polygon, its validity,
+ * the extremal points of its outer ring and a %PreparedRing for the outer ring and for every hole.
+ * A prepared polygon is immutable, so it may be shared by concurrent calls of %generate_nfp.
+ */
+class PreparedPolygon {
+	//on the heap, so the rings the prepared rings refer to don't move with the prepared polygon
+	std::unique_ptr<polygon_t> polygon_;
+	bool checked_ = false;
+	bool valid_ = true;
+	std::string reason_;
+	std::vector<psize_t> xMin_;
+	std::vector<psize_t> xMax_;
+	std::vector<psize_t> yMin_;
+	std::vector<psize_t> yMax_;
+	std::vector<PreparedRing> rings_;
+
+	PreparedPolygon() = default;
+
+	void prepare_rings() {
+		rings_.emplace_back(polygon_->outer());
+		for (const auto& r : polygon_->inners())
+			rings_.emplace_back(r);
+	}
+public:
+	/**
+	 * @brief Prepare a polygon: remove co-linear points, correct the orientation and optionally check the validity.
+	 * @param p The polygon. It is copied.
+	 * @param checkValidity Check the cleaned polygon for validity if true. Defaults to true.
+	 */
+	explicit PreparedPolygon(const polygon_t& p, const bool checkValidity = true) :
+			polygon_(new polygon_t(p)), checked_(checkValidity) {
+		remove_co_linear(*polygon_);
+
+		if (checkValidity)
+			valid_ = bg::is_valid(*polygon_, reason_);
+
+		xMin_ = find_minimum_x(*polygon_);
+		xMax_ = find_maximum_x(*polygon_);
+		yMin_ = find_minimum_y(*polygon_);
+		yMax_ = find_maximum_y(*polygon_);
+		prepare_rings();
+	}
+
+	PreparedPolygon(PreparedPolygon&&) = default;
+	PreparedPolygon& operator=(PreparedPolygon&&) = default;
+
+	/**
+	 * @brief Create a translated copy. The validity and the extremal points are taken over, only the rings are prepared anew.
+	 * @param trans The translation.
+	 * @return The translated prepared polygon.
+	 */
+	PreparedPolygon translated(const point_t& trans) const {
+		PreparedPolygon result;
+		result.polygon_.reset(new polygon_t());
+		trans::translate_transformer<coord_t, 2, 2> transformer(trans.x_, trans.y_);
+		boost::geometry::transform(*polygon_, *result.polygon_, transformer);
+		result.checked_ = checked_;
+		result.valid_ = valid_;
+		result.reason_ = reason_;
+		result.xMin_ = xMin_;
+		result.xMax_ = xMax_;
+		result.yMin_ = yMin_;
+		result.yMax_ = yMax_;
+		result.prepare_rings();
+		return result;
+	}
+
+	/**
+	 * @return The cleaned polygon.
+	 */
+	const polygon_t& polygon() const {
+		return *polygon_;
+	}
+
+	const polygon_t::ring_type& outer() const {
+		return polygon_->outer();
+	}
+
+	const PreparedRing& prepared_outer() const {
+		return rings_.front();
+	}
+
+	/**
+	 * @param i The index of the hole.
+	 * @return The prepared ring of the hole.
+	 */
+	const PreparedRing& prepared_inner(const psize_t& i) const {
+		return rings_[i + 1];
+	}
+
+	psize_t num_inners() const {
+		return rings_.size() - 1;
+	}
+
+	/**
+	 * @return true if the polygon was checked for validity on preparation.
+	 */
+	bool checked() const {
+		return checked_;
+	}
+
+	/**
+	 * @return false if the polygon was checked and found invalid.
+	 */
+	bool valid() const {
+		return valid_;
+	}
+
+	/**
+	 * @return The reason the polygon is invalid as given by bg::is_valid.
+	 */
+	const std::string& reason() const {
+		return reason_;
+	}
+
+	/**
+	 * @return The indices of the points of the outer ring with the minimum x coordinate (see %find_minimum_x).
+	 */
+	const std::vector<psize_t>& minimum_x() const {
+		return xMin_;
+	}
+
+	const std::vector<psize_t>& maximum_x() const {
+		return xMax_;
+	}
+
+	const std::vector<psize_t>& minimum_y() const {
+		return yMin_;
+	}
+
+	const std::vector<psize_t>& maximum_y() const {
+		return yMax_;
+	}
+
+	/**
+	 * @return The part of the translation to the positive quadrant that generate_nfp applies for this polygon.
+	 */
+	point_t quadrant_translation() const {
+		point_t trans;
+		const polygon_t::ring_type& o = polygon_->outer();
+
+		coord_t left = o[xMin_.front()].x_;
+		coord_t right = o[xMax_.front()].x_;
+		if (right < 0) {
+			trans.x_ = right * -1;
+		} else if (left < 0) {
+			trans.x_ = left * -1;
+		}
+
+		coord_t top = o[yMax_.front()].y_;
+		coord_t bottom = o[yMin_.front()].y_;
+		if (top < 0) {
+			trans.y_ = top * -1;
+		} else if (bottom < 0) {
+			trans.y_ = bottom * -1;
+		}
+		return trans;
+	}
+
+	/**
+	 * @return The translation that moves the minimum corner of the extents of the outer ring to the origin.
+	 */
+	point_t local_translation() const {
+		const polygon_t::ring_type& o = polygon_->outer();
+		return point_t(o[xMin_.front()].x_ * -1, o[yMin_.front()].y_ * -1);
+	}
+};
+}
+}
+
+#endif /* SRC_PREPARED_POLYGON_HPP_ */
@@ -0,0 +1,127 @@
+#ifndef SRC_PREPARED_RING_HPP_
+#define SRC_PREPARED_RING_HPP_
+
+#include <limits>
+
+#include "geometry.hpp"
+#include "edge_index.hpp"
+#include "translated_ring.hpp"
+#include "soa_ring.hpp"
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+/**
+ * @brief Translate a box.
+ * @param box The box.
+ * @param offset The translation.
+ * @return The translated box.
+ */
+boxf_t translate_box(const boxf_t& box, const point_t& offset) {
+	long double offX = toLongDouble(offset.x_);
+	long double offY = toLongDouble(offset.y_);
+	return boxf_t( { box.min_corner().x() + offX, box.min_corner().y() + offY }, { box.max_corner().x() + offX, box.max_corner().y() + offY });
+}
+
+/**
+ * @brief Calculate the exact extents of a (translated) ring.
+ * @param ring The ring.
+ * @return The bounding box of the ring.
+ */
+boxf_t make_box(const TranslatedRing& ring) {
+	long double minX = std::numeric_limits<long double>::max();
+	long double minY = std::numeric_limits<long double>::max();
+	long double maxX = std::numeric_limits<long double>::lowest();
+	long double maxY = std::numeric_limits<long double>::lowest();
+
+	for (const auto& pt : ring.local()) {
+		minX = std::min(minX, toLongDouble(pt.x_));
+		minY = std::min(minY, toLongDouble(pt.y_));
+		maxX = std::max(maxX, toLongDouble(pt.x_));
+		maxY = std::max(maxY, toLongDouble(pt.y_));
+	}
+
+	return translate_box(boxf_t( { minX, minY }, { maxX, maxY }), ring.offset());
+}
+
+/**
+ * @brief Check if a box lies within another box, allowing for the tolerance of the boost predicates.
+ * If this returns false no geometry with the extents of inner can be covered by a geometry with the extents of outer.
+ * @param inner The inner box.
+ * @param outer The outer box.
+ * @return true if inner lies within the grown outer box.
+ */
+bool box_within(const boxf_t& inner, const boxf_t& outer) {
+	boxf_t grown = make_box(point_t(outer.min_corner().x(), outer.min_corner().y()), point_t(outer.max_corner().x(), outer.max_corner().y()));
+	return bg::covered_by(inner, grown);
+}
+
+/**
+ * @brief A ring prepared for repeated point location and containment tests: its extents and an %EdgeIndex over its edges.
+ * Also keeps a %SoaRing copy of the ring for the orbit kernels.
+ */
+class PreparedRing {
+	const polygon_t::ring_type* ring_;
+	EdgeIndex index_;
+	boxf_t box_;
+	SoaRing soa_;
+public:
+	/**
+	 * @brief Prepare a ring.
+	 * @param ring The ring. Has to outlive the prepared ring and its coordinates may not change.
+	 */
+	explicit PreparedRing(const polygon_t::ring_type& ring) :
+			ring_(&ring), index_(ring), box_(make_box(TranslatedRing(ring))), soa_(ring) {
+	}
+
+	const polygon_t::ring_type& ring() const {
+		return *ring_;
+	}
+
+	const EdgeIndex& index() const {
+		return index_;
+	}
+
+	const boxf_t& box() const {
+		return box_;
+	}
+
+	const SoaRing& soa() const {
+		return soa_;
+	}
+
+	/**
+	 * @brief Locate a point relative to the ring. Gives exactly the same results as bg::within and bg::touches,
+	 * but only applies the winding strategy to the edges whose x-range contains the point, which are the only ones that
+	 * contribute to the winding number.
+	 * @param pt The point.
+	 * @return 1 if the point lies within the ring, 0 if it lies on its boundary and -1 if it lies outside.
+	 */
+	int locate(const point_t& pt) const {
+		typedef bg::strategy::within::cartesian_winding<point_t, point_t> strategy_t;
+		const polygon_t::ring_type& ring = *ring_;
+
+		//bg::within and bg::touches consider rings with less points invalid
+		if (ring.size() < bg::core_detail::closure::minimum_ring_size<bg::closure<polygon_t::ring_type>::value>::value)
+			return -1;
+
+		boxf_t band = make_box(pt, pt);
+		bg::set<bg::min_corner, 1>(band, std::numeric_limits<long double>::lowest());
+		bg::set<bg::max_corner, 1>(band, std::numeric_limits<long double>::max());
+
+		strategy_t::state_type state;
+		bool touches = false;
+		index_.for_each(band, [&](const psize_t& i) {
+			//the boost predicates iterate over the normalized (= clockwise) view of the ring, so the segment is passed in reverse order
+			if (!touches && !strategy_t::apply(pt, ring[i + 1], ring[i], state))
+				touches = true;
+		});
+
+		if (touches)
+			return 0;
+		return strategy_t::result(state);
+	}
+};
+}
+}
+
+#endif /* SRC_PREPARED_RING_HPP_ */
@@ -0,0 +1,306 @@
+#ifndef SRC_SIMD_HPP_
+#define SRC_SIMD_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <limits>
+
+#include "geometry.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIBNFP_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+#ifdef LIBNFP_USE_DOUBLE
+/**
+ * @brief The instruction sets the vectorized kernels of the double backend can use. Chosen at runtime (see %simd_level).
+ * SCALAR doesn't run the vectorized filters at all, which is the reference the other levels have to reproduce bit by bit.
+ */
+enum SimdLevel {
+	SIMD_SCALAR,//!< no vectorized kernels
+	SIMD_AVX2,  //!< 4 lanes
+	SIMD_AVX512 //!< 8 lanes
+};
+
+/**
+ * The number of lanes of a batch, which is the width of the widest instruction set.
+ */
+static constexpr size_t SIMD_BATCH = 8;
+
+/**
+ * The thresholds of the filters are widened by this factor. The scalar tests partially calculate in long double,
+ * so a filter only rejects what the scalar tests reject by a margin that covers the difference in rounding.
+ */
+static constexpr double SIMD_WIDEN = 1.000001;
+
+/**
+ * @return The best level the CPU supports.
+ */
+inline SimdLevel detect_simd_level() {
+#ifdef LIBNFP_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return SIMD_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return SIMD_AVX2;
+#endif
+	return SIMD_SCALAR;
+}
+
+/**
+ * @return The level used by the kernels. Detected on first use.
+ */
+inline SimdLevel& simd_level() {
+	static SimdLevel level = detect_simd_level();
+	return level;
+}
+
+/**
+ * @brief Choose the level used by the kernels, e.g. to compare them with the scalar path. Levels the CPU doesn't support are lowered to the best supported one.
+ * Not thread safe, has to be called while no NFP is generated.
+ * @param level The level.
+ * @return The level that is used.
+ */
+inline SimdLevel set_simd_level(SimdLevel level) {
+	SimdLevel supported = detect_simd_level();
+	simd_level() = level > supported ? supported : level;
+	return simd_level();
+}
+
+/**
+ * @brief A batch of candidate pairs for %find_touching_points: vertex i of A with the edge starting there (a -> an)
+ * and vertex j of B with the edge starting there (b -> bn), all translated.
+ */
+struct TouchLanes {
+	alignas(64) double ax_[SIMD_BATCH];
+	alignas(64) double ay_[SIMD_BATCH];
+	alignas(64) double anx_[SIMD_BATCH];
+	alignas(64) double any_[SIMD_BATCH];
+	alignas(64) double bx_[SIMD_BATCH];
+	alignas(64) double by_[SIMD_BATCH];
+	alignas(64) double bnx_[SIMD_BATCH];
+	alignas(64) double bny_[SIMD_BATCH];
+};
+
+/**
+ * @brief A batch of segments for %cast_translation.
+ */
+struct RayLanes {
+	alignas(64) double q1x_[SIMD_BATCH];
+	alignas(64) double q1y_[SIMD_BATCH];
+	alignas(64) double q2x_[SIMD_BATCH];
+	alignas(64) double q2y_[SIMD_BATCH];
+};
+
+#ifdef LIBNFP_SIMD_X86
+__attribute__((target("avx2")))
+inline __m256d abs_avx2(__m256d v) {
+	return _mm256_andnot_pd(_mm256_set1_pd(-0.0), v);
+}
+
+/**
+ * @return A lane is set if a and b are certainly further apart than %equals tolerates.
+ */
+__attribute__((target("avx2")))
+inline __m256d differs_avx2(__m256d a, __m256d b, __m256d eps) {
+	__m256d bound = _mm256_mul_pd(eps, _mm256_max_pd(abs_avx2(a), abs_avx2(b)));
+	return _mm256_cmp_pd(abs_avx2(_mm256_sub_pd(a, b)), bound, _CMP_GT_OQ);
+}
+
+/**
+ * @return A lane is set if the points are certainly not %near.
+ */
+__attribute__((target("avx2")))
+inline __m256d not_near_avx2(__m256d px, __m256d py, __m256d qx, __m256d qy, __m256d eps2) {
+	const __m256d one = _mm256_set1_pd(1.0);
+	__m256d bx = _mm256_mul_pd(eps2, _mm256_max_pd(_mm256_max_pd(abs_avx2(px), abs_avx2(qx)), one));
+	__m256d by = _mm256_mul_pd(eps2, _mm256_max_pd(_mm256_max_pd(abs_avx2(py), abs_avx2(qy)), one));
+	return _mm256_or_pd(_mm256_cmp_pd(abs_avx2(_mm256_sub_pd(px, qx)), bx, _CMP_GT_OQ), _mm256_cmp_pd(abs_avx2(_mm256_sub_pd(py, qy)), by, _CMP_GT_OQ));
+}
+
+/**
+ * @return A lane is set if %on_segment(a, b, pt) certainly rejects the point without calling bg::intersects.
+ */
+__attribute__((target("avx2")))
+inline __m256d off_segment_avx2(__m256d ax, __m256d ay, __m256d bx, __m256d by, __m256d px, __m256d py) {
+	const __m256d eps2 = _mm256_set1_pd(2 * NFP_EPSILON * SIMD_WIDEN);
+	const __m256d errFactor = _mm256_set1_pd(16 * std::numeric_limits<double>::epsilon());
+	__m256d dx = _mm256_sub_pd(bx, ax);
+	__m256d dy = _mm256_sub_pd(by, ay);
+	__m256d dpx = _mm256_sub_pd(px, ax);
+	__m256d dpy = _mm256_sub_pd(py, ay);
+	__m256d det = _mm256_sub_pd(_mm256_mul_pd(dx, dpy), _mm256_mul_pd(dy, dpx));
+	__m256d m = _mm256_max_pd(_mm256_max_pd(abs_avx2(dx), abs_avx2(dy)), _mm256_max_pd(abs_avx2(dpx), abs_avx2(dpy)));
+	m = _mm256_max_pd(m, _mm256_max_pd(abs_avx2(_mm256_sub_pd(px, bx)), abs_avx2(_mm256_sub_pd(py, by))));
+	__m256d bound = _mm256_mul_pd(_mm256_add_pd(_mm256_set1_pd(2 * NFP_EPSILON), _mm256_mul_pd(_mm256_mul_pd(errFactor, m), m)), _mm256_set1_pd(SIMD_WIDEN));
+	__m256d far = _mm256_cmp_pd(abs_avx2(det), bound, _CMP_GT_OQ);
+	far = _mm256_and_pd(far, not_near_avx2(px, py, ax, ay, eps2));
+	far = _mm256_and_pd(far, not_near_avx2(px, py, bx, by, eps2));
+	return _mm256_and_pd(far, not_near_avx2(ax, ay, bx, by, eps2));
+}
+
+__attribute__((target("avx2")))
+inline uint32_t touch_mask_avx2(const TouchLanes& l, size_t n) {
+	const __m256d eps = _mm256_set1_pd(NFP_EPSILON * SIMD_WIDEN);
+	uint32_t mask = 0;
+	for (size_t k = 0; k < n; k += 4) {
+		__m256d ax = _mm256_load_pd(l.ax_ + k), ay = _mm256_load_pd(l.ay_ + k);
+		__m256d anx = _mm256_load_pd(l.anx_ + k), any = _mm256_load_pd(l.any_ + k);
+		__m256d bx = _mm256_load_pd(l.bx_ + k), by = _mm256_load_pd(l.by_ + k);
+		__m256d bnx = _mm256_load_pd(l.bnx_ + k), bny = _mm256_load_pd(l.bny_ + k);
+		__m256d apart = _mm256_or_pd(differs_avx2(ax, bx, eps), differs_avx2(ay, by, eps));
+		__m256d rejected = _mm256_and_pd(apart, off_segment_avx2(ax, ay, anx, any, bx, by));
+		rejected = _mm256_and_pd(rejected, off_segment_avx2(bx, by, bnx, bny, ax, ay));
+		mask |= uint32_t(~_mm256_movemask_pd(rejected) & 0xF) << k;
+	}
+	return mask;
+}
+
+__attribute__((target("avx2")))
+inline uint32_t ray_mask_avx2(const point_t& pt, const point_t& dir, const RayLanes& l, size_t n) {
+	const __m256d lo = _mm256_set1_pd(-NFP_EPSILON * SIMD_WIDEN);
+	const __m256d hi = _mm256_set1_pd(1 + NFP_EPSILON * SIMD_WIDEN);
+	const __m256d px = _mm256_set1_pd(pt.x_.val()), py = _mm256_set1_pd(pt.y_.val());
+	const __m256d dx = _mm256_set1_pd(dir.x_.val()), dy = _mm256_set1_pd(dir.y_.val());
+	const __m256d dirLen = _mm256_add_pd(abs_avx2(dx), abs_avx2(dy));
+	uint32_t mask = 0;
+	for (size_t k = 0; k < n; k += 4) {
+		__m256d q1x = _mm256_load_pd(l.q1x_ + k), q1y = _mm256_load_pd(l.q1y_ + k);
+		__m256d ex = _mm256_sub_pd(_mm256_load_pd(l.q2x_ + k), q1x), ey = _mm256_sub_pd(_mm256_load_pd(l.q2y_ + k), q1y);
+		__m256d wx = _mm256_sub_pd(q1x, px), wy = _mm256_sub_pd(q1y, py);
+		__m256d denom = _mm256_sub_pd(_mm256_mul_pd(dx, ey), _mm256_mul_pd(dy, ex));
+		__m256d parallelBound = _mm256_mul_pd(_mm256_mul_pd(dirLen, _mm256_add_pd(abs_avx2(ex), abs_avx2(ey))), _mm256_set1_pd(NFP_EPSILON * SIMD_WIDEN));
+		__m256d skew = _mm256_cmp_pd(abs_avx2(denom), parallelBound, _CMP_GT_OQ);
+		__m256d t = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(wx, ey), _mm256_mul_pd(wy, ex)), denom);
+		__m256d s = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(wx, dy), _mm256_mul_pd(wy, dx)), denom);
+		__m256d outside = _mm256_or_pd(_mm256_cmp_pd(t, lo, _CMP_LT_OQ), _mm256_cmp_pd(t, hi, _CMP_GT_OQ));
+		outside = _mm256_or_pd(outside, _mm256_or_pd(_mm256_cmp_pd(s, lo, _CMP_LT_OQ), _mm256_cmp_pd(s, hi, _CMP_GT_OQ)));
+		mask |= uint32_t(~_mm256_movemask_pd(_mm256_and_pd(skew, outside)) & 0xF) << k;
+	}
+	return mask;
+}
+
+/**
+ * @brief Same as _mm512_max_pd, which gcc warns about, because it passes an undefined register as the (unused) source of the masked lanes.
+ */
+__attribute__((target("avx512f")))
+inline __m512d max_avx512(__m512d a, __m512d b) {
+	return _mm512_mask_max_pd(a, 0xFF, a, b);
+}
+
+__attribute__((target("avx512f")))
+inline __mmask8 differs_avx512(__m512d a, __m512d b, __m512d eps) {
+	__m512d bound = _mm512_mul_pd(eps, max_avx512(_mm512_abs_pd(a), _mm512_abs_pd(b)));
+	return _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(a, b)), bound, _CMP_GT_OQ);
+}
+
+__attribute__((target("avx512f")))
+inline __mmask8 not_near_avx512(__m512d px, __m512d py, __m512d qx, __m512d qy, __m512d eps2) {
+	const __m512d one = _mm512_set1_pd(1.0);
+	__m512d bx = _mm512_mul_pd(eps2, max_avx512(max_avx512(_mm512_abs_pd(px), _mm512_abs_pd(qx)), one));
+	__m512d by = _mm512_mul_pd(eps2, max_avx512(max_avx512(_mm512_abs_pd(py), _mm512_abs_pd(qy)), one));
+	return _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(px, qx)), bx, _CMP_GT_OQ) | _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(py, qy)), by, _CMP_GT_OQ);
+}
+
+__attribute__((target("avx512f")))
+inline __mmask8 off_segment_avx512(__m512d ax, __m512d ay, __m512d bx, __m512d by, __m512d px, __m512d py) {
+	const __m512d eps2 = _mm512_set1_pd(2 * NFP_EPSILON * SIMD_WIDEN);
+	const __m512d errFactor = _mm512_set1_pd(16 * std::numeric_limits<double>::epsilon());
+	__m512d dx = _mm512_sub_pd(bx, ax);
+	__m512d dy = _mm512_sub_pd(by, ay);
+	__m512d dpx = _mm512_sub_pd(px, ax);
+	__m512d dpy = _mm512_sub_pd(py, ay);
+	__m512d det = _mm512_sub_pd(_mm512_mul_pd(dx, dpy), _mm512_mul_pd(dy, dpx));
+	__m512d m = max_avx512(max_avx512(_mm512_abs_pd(dx), _mm512_abs_pd(dy)), max_avx512(_mm512_abs_pd(dpx), _mm512_abs_pd(dpy)));
+	m = max_avx512(m, max_avx512(_mm512_abs_pd(_mm512_sub_pd(px, bx)), _mm512_abs_pd(_mm512_sub_pd(py, by))));
+	__m512d bound = _mm512_mul_pd(_mm512_add_pd(_mm512_set1_pd(2 * NFP_EPSILON), _mm512_mul_pd(_mm512_mul_pd(errFactor, m), m)), _mm512_set1_pd(SIMD_WIDEN));
+	__mmask8 far = _mm512_cmp_pd_mask(_mm512_abs_pd(det), bound, _CMP_GT_OQ);
+	return far & not_near_avx512(px, py, ax, ay, eps2) & not_near_avx512(px, py, bx, by, eps2) & not_near_avx512(ax, ay, bx, by, eps2);
+}
+
+__attribute__((target("avx512f")))
+inline uint32_t touch_mask_avx512(const TouchLanes& l, size_t n) {
+	const __m512d eps = _mm512_set1_pd(NFP_EPSILON * SIMD_WIDEN);
+	__m512d ax = _mm512_load_pd(l.ax_), ay = _mm512_load_pd(l.ay_);
+	__m512d anx = _mm512_load_pd(l.anx_), any = _mm512_load_pd(l.any_);
+	__m512d bx = _mm512_load_pd(l.bx_), by = _mm512_load_pd(l.by_);
+	__m512d bnx = _mm512_load_pd(l.bnx_), bny = _mm512_load_pd(l.bny_);
+	__mmask8 apart = differs_avx512(ax, bx, eps) | differs_avx512(ay, by, eps);
+	__mmask8 rejected = apart & off_segment_avx512(ax, ay, anx, any, bx, by) & off_segment_avx512(bx, by, bnx, bny, ax, ay);
+	return uint32_t(~rejected & 0xFF);
+}
+
+__attribute__((target("avx512f")))
+inline uint32_t ray_mask_avx512(const point_t& pt, const point_t& dir, const RayLanes& l, size_t n) {
+	const __m512d lo = _mm512_set1_pd(-NFP_EPSILON * SIMD_WIDEN);
+	const __m512d hi = _mm512_set1_pd(1 + NFP_EPSILON * SIMD_WIDEN);
+	const __m512d px = _mm512_set1_pd(pt.x_.val()), py = _mm512_set1_pd(pt.y_.val());
+	const __m512d dx = _mm512_set1_pd(dir.x_.val()), dy = _mm512_set1_pd(dir.y_.val());
+	const __m512d dirLen = _mm512_add_pd(_mm512_abs_pd(dx), _mm512_abs_pd(dy));
+	__m512d q1x = _mm512_load_pd(l.q1x_), q1y = _mm512_load_pd(l.q1y_);
+	__m512d ex = _mm512_sub_pd(_mm512_load_pd(l.q2x_), q1x), ey = _mm512_sub_pd(_mm512_load_pd(l.q2y_), q1y);
+	__m512d wx = _mm512_sub_pd(q1x, px), wy = _mm512_sub_pd(q1y, py);
+	__m512d denom = _mm512_sub_pd(_mm512_mul_pd(dx, ey), _mm512_mul_pd(dy, ex));
+	__m512d parallelBound = _mm512_mul_pd(_mm512_mul_pd(dirLen, _mm512_add_pd(_mm512_abs_pd(ex), _mm512_abs_pd(ey))), _mm512_set1_pd(NFP_EPSILON * SIMD_WIDEN));
+	__mmask8 skew = _mm512_cmp_pd_mask(_mm512_abs_pd(denom), parallelBound, _CMP_GT_OQ);
+	__m512d t = _mm512_div_pd(_mm512_sub_pd(_mm512_mul_pd(wx, ey), _mm512_mul_pd(wy, ex)), denom);
+	__m512d s = _mm512_div_pd(_mm512_sub_pd(_mm512_mul_pd(wx, dy), _mm512_mul_pd(wy, dx)), denom);
+	__mmask8 outside = _mm512_cmp_pd_mask(t, lo, _CMP_LT_OQ) | _mm512_cmp_pd_mask(t, hi, _CMP_GT_OQ) | _mm512_cmp_pd_mask(s, lo, _CMP_LT_OQ) | _mm512_cmp_pd_mask(s, hi, _CMP_GT_OQ);
+	return uint32_t(~(skew & outside) & 0xFF);
+}
+#endif
+
+/**
+ * @brief Filter a batch of candidate pairs of %find_touching_points.
+ * A bit is cleared only if the scalar tests certainly find neither a vertex touching nor a vertex on the edge of the other ring:
+ * the vertices differ by more than %equals tolerates and %on_segment rejects both vertices in its floating point prefilter.
+ * @param lanes The candidates. Lanes beyond n have to be initialized, but their bits are meaningless.
+ * @param n The number of candidates.
+ * @return A bit mask of the candidates that have to be tested by the scalar code. All bits are set at the scalar level.
+ */
+inline uint32_t touch_mask(const TouchLanes& lanes, size_t n) {
+#ifdef LIBNFP_SIMD_X86
+	switch (simd_level()) {
+	case SIMD_AVX512:
+		return touch_mask_avx512(lanes, n);
+	case SIMD_AVX2:
+		return touch_mask_avx2(lanes, n);
+	default:
+		break;
+	}
+#endif
+	return (uint32_t(1) << n) - 1;
+}
+
+/**
+ * @brief Filter a batch of segments for the translation of a point (pt -> pt + dir).
+ * A bit is cleared only if %intersect_translation certainly returns no hit: the segment isn't parallel to the translation
+ * and one of the parameters of the intersection lies outside of what %snap_parameter accepts.
+ * @param pt The translated point.
+ * @param dir The translation.
+ * @param lanes The segments. Lanes beyond n have to be initialized, but their bits are meaningless.
+ * @param n The number of segments.
+ * @return A bit mask of the segments that have to be intersected by the scalar code. All bits are set at the scalar level.
+ */
+inline uint32_t ray_mask(const point_t& pt, const point_t& dir, const RayLanes& lanes, size_t n) {
+#ifdef LIBNFP_SIMD_X86
+	switch (simd_level()) {
+	case SIMD_AVX512:
+		return ray_mask_avx512(pt, dir, lanes, n);
+	case SIMD_AVX2:
+		return ray_mask_avx2(pt, dir, lanes, n);
+	default:
+		break;
+	}
+#endif
+	return (uint32_t(1) << n) - 1;
+}
+#endif
+}
+}
+
+#endif /* SRC_SIMD_HPP_ */
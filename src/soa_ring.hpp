@@ -0,0 +1,205 @@
+#ifndef SRC_SOA_RING_HPP_
+#define SRC_SOA_RING_HPP_
+
+#include <vector>
+
+#include "geometry.hpp"
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+/**
+ * @brief A ring in structure-of-arrays layout for the orbit kernels: the coordinates and the edge directions are kept in contiguous arrays.
+ * Indices are those of the (closed) ring, so the last index is the closing point. The arrays are padded with the neighbours across
+ * the closing point, so the previous and next vertex and the incoming and outgoing edge of every index are found without wrap-around branches.
+ * The edge directions are calculated exactly like the difference of the two points would be.
+ */
+class SoaRing {
+	const polygon_t::ring_type* ring_;
+	//x_[i + 1] is the x coordinate of point i. x_[0] is the point before the first one, x_[size + 1] the point after the closing point.
+	std::vector<coord_t> x_;
+	std::vector<coord_t> y_;
+	//dx_[i + 1] is the x component of edge i (= point i + 1 - point i). dx_[0] is the edge before the first one, dx_[size] the edge after the closing point.
+	std::vector<coord_t> dx_;
+	std::vector<coord_t> dy_;
+	psize_t size_;
+
+	void translate_padded(const psize_t& k, const point_t& offset, point_t& target) const {
+#if defined(LIBNFP_USE_RATIONAL) && !defined(LIBNFP_USE_LAZY_RATIONAL)
+		mpq_add(mpq(target.x_), mpq(x_[k]), mpq(offset.x_));
+		mpq_add(mpq(target.y_), mpq(y_[k]), mpq(offset.y_));
+#else
+		target.x_ = x_[k] + offset.x_;
+		target.y_ = y_[k] + offset.y_;
+#endif
+	}
+public:
+	/**
+	 * @brief Copy a ring into structure-of-arrays layout.
+	 * @param ring The closed ring. Has to have at least two points. Has to outlive the copy and its coordinates may not change.
+	 */
+	explicit SoaRing(const polygon_t::ring_type& ring) :
+			ring_(&ring), size_(ring.size()) {
+		assert(size_ >= 2);
+		x_.reserve(size_ + 2);
+		y_.reserve(size_ + 2);
+		x_.push_back(ring[size_ - 2].x_);
+		y_.push_back(ring[size_ - 2].y_);
+		for (const auto& pt : ring) {
+			x_.push_back(pt.x_);
+			y_.push_back(pt.y_);
+		}
+		x_.push_back(ring[1].x_);
+		y_.push_back(ring[1].y_);
+
+		dx_.resize(size_ + 1);
+		dy_.resize(size_ + 1);
+		for (psize_t i = 0; i + 1 < size_; ++i) {
+			dx_[i + 1] = x_[i + 2] - x_[i + 1];
+			dy_[i + 1] = y_[i + 2] - y_[i + 1];
+		}
+		dx_[0] = dx_[size_ - 1];
+		dy_[0] = dy_[size_ - 1];
+		dx_[size_] = dx_[1];
+		dy_[size_] = dy_[1];
+	}
+
+	/**
+	 * @return The number of points including the closing point.
+	 */
+	psize_t size() const {
+		return size_;
+	}
+
+	/**
+	 * @return The ring the arrays were copied from.
+	 */
+	const polygon_t::ring_type& ring() const {
+		return *ring_;
+	}
+
+	/**
+	 * @return The x coordinates of the points, including the closing point.
+	 */
+	const coord_t* xs() const {
+		return x_.data() + 1;
+	}
+
+	/**
+	 * @return The y coordinates of the points, including the closing point.
+	 */
+	const coord_t* ys() const {
+		return y_.data() + 1;
+	}
+
+	point_t operator[](const psize_t& i) const {
+		return point_t(x_[i + 1], y_[i + 1]);
+	}
+
+	/**
+	 * @brief Write a point to an existing point, which reuses its storage.
+	 * @param i The index of the point.
+	 * @param target The point to write to.
+	 */
+	void get(const psize_t& i, point_t& target) const {
+		target.x_ = x_[i + 1];
+		target.y_ = y_[i + 1];
+	}
+
+	/**
+	 * @param i The index of a point.
+	 * @return The point before it. The point before the first one is the one before the closing point.
+	 */
+	point_t prev(const psize_t& i) const {
+		return point_t(x_[i], y_[i]);
+	}
+
+	/**
+	 * @brief Write the point before a point to an existing point, which reuses its storage.
+	 * @param i The index of a point.
+	 * @param target The point to write to.
+	 */
+	void get_prev(const psize_t& i, point_t& target) const {
+		target.x_ = x_[i];
+		target.y_ = y_[i];
+	}
+
+	/**
+	 * @param i The index of a point.
+	 * @return The point after it. The point after the closing point is the second one.
+	 */
+	point_t next(const psize_t& i) const {
+		return point_t(x_[i + 2], y_[i + 2]);
+	}
+
+	/**
+	 * @brief Write the point after a point to an existing point, which reuses its storage.
+	 * @param i The index of a point.
+	 * @param target The point to write to.
+	 */
+	void get_next(const psize_t& i, point_t& target) const {
+		target.x_ = x_[i + 2];
+		target.y_ = y_[i + 2];
+	}
+
+	/**
+	 * @param i The index of a point.
+	 * @return The direction of the edge that starts at the point.
+	 */
+	point_t outgoing(const psize_t& i) const {
+		return point_t(dx_[i + 1], dy_[i + 1]);
+	}
+
+	/**
+	 * @param i The index of a point.
+	 * @return The direction of the edge that ends at the point.
+	 */
+	point_t incoming(const psize_t& i) const {
+		return point_t(dx_[i], dy_[i]);
+	}
+
+	/**
+	 * @brief Write a translated point to an existing point, which reuses its storage.
+	 * @param i The index of the point.
+	 * @param offset The translation.
+	 * @param target The point to write to.
+	 */
+	void translated(const psize_t& i, const point_t& offset, point_t& target) const {
+		translate_padded(i + 1, offset, target);
+	}
+
+	/**
+	 * @brief Write the translated point before a point to an existing point, which reuses its storage.
+	 * @param i The index of a point.
+	 * @param offset The translation.
+	 * @param target The point to write to.
+	 */
+	void translated_prev(const psize_t& i, const point_t& offset, point_t& target) const {
+		translate_padded(i, offset, target);
+	}
+
+	/**
+	 * @brief Write the translated point after a point to an existing point, which reuses its storage.
+	 * @param i The index of a point.
+	 * @param offset The translation.
+	 * @param target The point to write to.
+	 */
+	void translated_next(const psize_t& i, const point_t& offset, point_t& target) const {
+		translate_padded(i + 2, offset, target);
+	}
+
+	/**
+	 * @brief Write the translated points to a ring. Reuses the storage of the target ring.
+	 * @param offset The translation.
+	 * @param target The ring to write to.
+	 */
+	void materialize(const point_t& offset, polygon_t::ring_type& target) const {
+		target.resize(size_);
+		for (psize_t i = 0; i < size_; ++i) {
+			translated(i, offset, target[i]);
+		}
+	}
+};
+}
+}
+
+#endif /* SRC_SOA_RING_HPP_ */
@@ -12,6 +12,7 @@
 #include "geometry.hpp"
 
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
 /**
  * @brief Because the boost svg mapper can't handle our custom types we have to convert polygon_t::ring_type to polygonf_t::ring_type (which is using "long double" as coordinate type).
  * @param r The ring to convert.
@@ -139,6 +140,7 @@ void write_svg(std::string const& filename, const polygon_t& pA, const polygon_t
 	}
 }
 }
+}
 
 #endif /* SRC_SVG_HPP_ */
 
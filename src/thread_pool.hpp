@@ -0,0 +1,258 @@
+#ifndef SRC_THREAD_POOL_HPP_
+#define SRC_THREAD_POOL_HPP_
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <exception>
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+/**
+ * @brief A fixed size pool of worker threads.
+ */
+class ThreadPool {
+	std::vector<std::thread> workers_;
+	std::deque<std::function<void()>> tasks_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	bool stop_ = false;
+
+	/**
+	 * @brief Bookkeeping shared by the parallel loops: counts finished calls and keeps the exception of the lowest index.
+	 */
+	struct completion_t {
+		const size_t n_;
+		size_t done_ = 0;
+		size_t failedIndex_ = 0;
+		std::exception_ptr error_;
+		std::mutex mutex_;
+		std::condition_variable cv_;
+
+		explicit completion_t(const size_t& n) : n_(n) {
+		}
+
+		template<typename Function>
+		void call(Function fn, const size_t& i) {
+			std::exception_ptr error;
+			try {
+				fn(i);
+			} catch (...) {
+				error = std::current_exception();
+			}
+
+			std::unique_lock<std::mutex> lock(mutex_);
+			if (error && (!error_ || i < failedIndex_)) {
+				error_ = error;
+				failedIndex_ = i;
+			}
+			if (++done_ == n_)
+				cv_.notify_all();
+		}
+
+		void wait() {
+			std::unique_lock<std::mutex> lock(mutex_);
+			cv_.wait(lock, [&]() {
+				return done_ == n_;
+			});
+
+			if (error_)
+				std::rethrow_exception(error_);
+		}
+	};
+
+	void work() {
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				cv_.wait(lock, [&]() {
+					return stop_ || !tasks_.empty();
+				});
+				if (stop_ && tasks_.empty())
+					return;
+
+				task = std::move(tasks_.front());
+				tasks_.pop_front();
+			}
+			task();
+		}
+	}
+public:
+	/**
+	 * @brief Start the worker threads.
+	 * @param threads The number of worker threads. Defaults to the number of hardware threads.
+	 */
+	explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+		if (threads == 0)
+			threads = 1;
+
+		for (size_t i = 0; i < threads; ++i) {
+			workers_.emplace_back([this]() {
+				work();
+			});
+		}
+	}
+
+	/**
+	 * @brief Finish all queued tasks and join the worker threads.
+	 */
+	~ThreadPool() {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		cv_.notify_all();
+		for (auto& w : workers_) {
+			w.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t size() const {
+		return workers_.size();
+	}
+
+	/**
+	 * @brief Queue a task.
+	 * @param task The task. Must not throw.
+	 */
+	void submit(std::function<void()> task) {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			tasks_.push_back(std::move(task));
+		}
+		cv_.notify_one();
+	}
+
+	/**
+	 * @brief Call fn(i) for every i in [0, n) on the workers and on the calling thread and wait until all calls returned.
+	 * The calling thread takes part in the work, so parallel_for may be nested (e.g. called from a task of the same pool) without deadlocking.
+	 * @param n The number of calls.
+	 * @param fn The function to call.
+	 * @throws The exception thrown by the call with the lowest index, if any of the calls threw.
+	 */
+	template<typename Function>
+	void parallel_for(const size_t& n, Function fn) {
+		if (n == 0)
+			return;
+
+		struct state_t : public completion_t {
+			std::atomic<size_t> next_ { 0 };
+			state_t(const size_t& n) : completion_t(n) {
+			}
+		};
+		//late workers may still look at the state after parallel_for returned
+		auto state = std::make_shared<state_t>(n);
+
+		auto run = [state, n, &fn]() {
+			size_t i;
+			while ((i = state->next_++) < n) {
+				state->call(fn, i);
+			}
+		};
+
+		size_t helpers = std::min(n - 1, size());
+		for (size_t i = 0; i < helpers; ++i) {
+			//fn may only be referenced while there is work left, which is guaranteed by the wait below
+			submit(run);
+		}
+		run();
+		state->wait();
+	}
+
+	/**
+	 * @brief Call fn(i) for every i in order on the workers and on the calling thread and wait until all calls returned.
+	 * The indices are dealt round-robin to one queue per participating thread. Every thread works on its own queue from the front
+	 * and, once that is empty, steals from the back of the fullest other queue. Ordering the indices by decreasing cost
+	 * therefore starts the expensive calls first and leaves the cheap ones for balancing at the end.
+	 * Like %parallel_for it may be nested.
+	 * @param order The indices to call fn with, in the order they should be started.
+	 * @param fn The function to call.
+	 * @throws The exception thrown by the call with the lowest position in order, if any of the calls threw.
+	 */
+	template<typename Function>
+	void parallel_for_stealing(const std::vector<size_t>& order, Function fn) {
+		const size_t n = order.size();
+		if (n == 0)
+			return;
+
+		const size_t participants = std::min(n, size() + 1);
+		struct queue_t {
+			std::deque<size_t> positions_;
+			std::mutex mutex_;
+		};
+		struct state_t : public completion_t {
+			std::vector<queue_t> queues_;
+			std::atomic<size_t> nextParticipant_ { 0 };
+			state_t(const size_t& n, const size_t& participants) : completion_t(n), queues_(participants) {
+			}
+
+			bool pop(const size_t& self, size_t& pos) {
+				if (self < queues_.size()) {
+					std::unique_lock<std::mutex> lock(queues_[self].mutex_);
+					if (!queues_[self].positions_.empty()) {
+						pos = queues_[self].positions_.front();
+						queues_[self].positions_.pop_front();
+						return true;
+					}
+				}
+
+				while (true) {
+					//steal from the fullest queue
+					size_t victim = queues_.size();
+					size_t most = 0;
+					for (size_t q = 0; q < queues_.size(); ++q) {
+						std::unique_lock<std::mutex> lock(queues_[q].mutex_);
+						if (queues_[q].positions_.size() > most) {
+							most = queues_[q].positions_.size();
+							victim = q;
+						}
+					}
+					if (victim == queues_.size())
+						return false;
+
+					std::unique_lock<std::mutex> lock(queues_[victim].mutex_);
+					if (!queues_[victim].positions_.empty()) {
+						pos = queues_[victim].positions_.back();
+						queues_[victim].positions_.pop_back();
+						return true;
+					}
+				}
+			}
+		};
+		//late workers may still look at the state after parallel_for_stealing returned
+		auto state = std::make_shared<state_t>(n, participants);
+		for (size_t pos = 0; pos < n; ++pos) {
+			state->queues_[pos % participants].positions_.push_back(pos);
+		}
+
+		auto run = [state, &order, &fn]() {
+			size_t self = state->nextParticipant_++;
+			size_t pos;
+			while (state->pop(self, pos)) {
+				state->call([&](const size_t& p) {
+					fn(order[p]);
+				}, pos);
+			}
+		};
+
+		for (size_t i = 1; i < participants; ++i) {
+			//order and fn may only be referenced while there is work left, which is guaranteed by the wait below
+			submit(run);
+		}
+		run();
+		state->wait();
+	}
+};
+}
+}
+
+#endif /* SRC_THREAD_POOL_HPP_ */
@@ -0,0 +1,85 @@
+#ifndef SRC_TRANSLATED_RING_HPP_
+#define SRC_TRANSLATED_RING_HPP_
+
+#include "geometry.hpp"
+
+namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
+/**
+ * @brief A view of a ring that is translated by an offset.
+ * The ring itself stays in its local coordinates and is never copied, so translating the view is O(1)
+ * and everything that refers to the local ring (e.g. an %EdgeIndex) stays valid.
+ */
+class TranslatedRing {
+private:
+	const polygon_t::ring_type* ring_;
+	point_t offset_;
+public:
+	/**
+	 * @brief Create a view of ring translated by offset.
+	 * @param ring The ring in local coordinates. Has to outlive the view.
+	 * @param offset The translation of the ring.
+	 */
+	TranslatedRing(const polygon_t::ring_type& ring, const point_t& offset = { 0, 0 }) :
+			ring_(&ring), offset_(offset) {
+	}
+
+	/**
+	 * @param i The index of the point.
+	 * @return The translated point.
+	 */
+	point_t operator[](const psize_t& i) const {
+		return (*ring_)[i] + offset_;
+	}
+
+	/**
+	 * @brief Write the translated point to an existing point, which reuses its storage.
+	 * @param i The index of the point.
+	 * @param target The point to write to.
+	 */
+	void translated(const psize_t& i, point_t& target) const {
+		assign_sum(target, (*ring_)[i], offset_);
+	}
+
+	point_t front() const {
+		return (*this)[0];
+	}
+
+	psize_t size() const {
+		return ring_->size();
+	}
+
+	/**
+	 * @return The ring in local coordinates.
+	 */
+	const polygon_t::ring_type& local() const {
+		return *ring_;
+	}
+
+	const point_t& offset() const {
+		return offset_;
+	}
+
+	/**
+	 * @brief Translate the view further.
+	 * @param trans The translation to add to the offset.
+	 */
+	void translate(const point_t& trans) {
+		offset_ = offset_ + trans;
+	}
+
+	/**
+	 * @brief Write the translated points to a ring. Reuses the storage of the target ring.
+	 * @param target The ring to write to.
+	 */
+	void materialize(polygon_t::ring_type& target) const {
+		target.resize(size());
+		for (psize_t i = 0; i < size(); ++i) {
+			translated(i, target[i]);
+		}
+	}
+};
+}
+}
+
+#endif /* SRC_TRANSLATED_RING_HPP_ */
@@ -1,17 +1,46 @@
 #ifndef SRC_TRANSLATION_VECTOR_HPP_
 #define SRC_TRANSLATION_VECTOR_HPP_
 
+#include <cstdint>
+
 #include "geometry.hpp"
 
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
 /**
  * TranslationVector is the struct used to store information about translations (including the segment it was derived from)
+ * It is copied with every candidate of a slide step, so the kind of touch it was derived from is kept as a one byte tag instead of a string.
  */
 struct TranslationVector {
+	/**
+	 * The case of %find_feasible_translation_vectors that derived the translation. Only used for debug output.
+	 */
+	enum Source : uint8_t {
+		UNKNOWN,
+		VERTEX1,
+		VERTEX2,
+		VERTEX3,
+		VERTEX5,
+		VERTEX6,
+		VERTEX7,
+		VERTEX8,
+		VERTEX9,
+		BONA,
+		AONB
+	};
+
 	point_t vector_;
 	segment_t edge_;
 	bool fromA_ = false;
-	string name_;
+	Source source_ = UNKNOWN;
+
+	/**
+	 * @return The name of the source of the translation.
+	 */
+	const char* name() const {
+		static const char* const names[] = { "", "vertex1", "vertex2", "vertex3", "vertex5", "vertex6", "vertex7", "vertex8", "vertex9", "bona", "aonb" };
+		return names[source_];
+	}
 
 	bool operator<(const TranslationVector& other) const {
 		return this->vector_ < other.vector_ || (equals(this->vector_, other.vector_) && (this->edge_ < other.edge_));
@@ -19,7 +48,7 @@ struct TranslationVector {
 };
 
 std::ostream& operator<<(std::ostream& os, const TranslationVector& tv) {
-	os << "{" << tv.edge_ << " -> " << tv.vector_ << "} = " << tv.name_;
+	os << "{" << tv.edge_ << " -> " << tv.vector_ << "} = " << tv.name();
 	return os;
 }
 
@@ -31,5 +60,6 @@ bool operator!=(const TranslationVector& lhs, const TranslationVector& rhs) {
 	return !operator==(lhs,rhs);
 }
 }
+}
 
 #endif /* SRC_TRANSLATION_VECTOR_HPP_ */
@@ -4,6 +4,7 @@
 #include "geometry.hpp"
 
 namespace libnfporb {
+inline namespace LIBNFP_BACKEND {
 /**
  * @brief Read a wkt polygon from a file.
  * @param filename The name of the file to read from.
@@ -25,6 +26,7 @@ void read_wkt_polygon(const string& filename, polygon_t& p) {
 	bg::correct(p);
 }
 }
+}
 
 
 #endif /* SRC_WKT_HPP_ */
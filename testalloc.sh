@@ -0,0 +1,13 @@
+truncate --size 0 testalloc.log
+if [ ! -x examples/alloccheck ]; then
+  echo "You need to build the examples to run the tests"
+  exit 2
+fi
+
+examples/alloccheck data/handcrafted/* 2>> testalloc.log
+if [ $? -eq 0 ]; then
+  echo Success
+else
+  echo Fail
+  exit 1
+fi
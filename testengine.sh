@@ -0,0 +1,13 @@
+truncate --size 0 testengine.log
+if [ ! -x examples/enginecheck ]; then
+  echo "You need to build the examples to run the tests"
+  exit 2
+fi
+
+examples/enginecheck data/handcrafted/* 2>> testengine.log
+if [ $? -eq 0 ]; then
+  echo Success
+else
+  echo Fail
+  exit 1
+fi
@@ -0,0 +1,13 @@
+truncate --size 0 testsimd.log
+if [ ! -x examples/simdcheck ]; then
+  echo "You need to build the examples to run the tests"
+  exit 2
+fi
+
+examples/simdcheck data/handcrafted/* 2>> testsimd.log
+if [ $? -eq 0 ]; then
+  echo Success
+else
+  echo Fail
+  exit 1
+fi